@@ -1,6 +1,412 @@
 #include "order_book.hpp"
+#include "lat_helper.hpp"
+#include "absl/container/flat_hash_map.h"
 
-int main() {
-	// warmup
-	// measure latency
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <immintrin.h>
+
+// Order book benchmark suite.
+//
+// Every workload is generated up front into a MarketEvent stream (generation
+// runs against a shadow book so cancels and modifies only target orders that
+// are still resting). Each workload then runs twice on fresh books:
+//   latency pass    - on_event per message, rdtsc around each call, recorded
+//                     per event type (aggressive adds reported as "take")
+//   throughput pass - on_events over the whole stream, wall clock only
+//
+// usage: order_book_bench [--workload NAME] [--events N] [--json FILE]
+
+namespace {
+
+using Book = OrderBook<>;
+
+constexpr Price MID = 1'000'000;
+constexpr size_t POOL_CAPACITY = 1 << 21;
+
+struct WorkloadSpec
+{
+	const char* name;
+	double add;           // passive adds
+	double cancel;
+	double modify;
+	double take;          // marketable adds that trade through the touch
+	size_t prefill;       // resting orders before the measured stream
+	double depth_scale;   // mean distance of passive adds from the touch, in levels
+	Price level_spacing;  // ticks between populated levels
+	double mean_gap_ns;   // > 0: Poisson arrivals, paced in the latency pass
+};
+
+// cancel:trade ratios stay in the 10-25x range typical of lit equity venues
+constexpr WorkloadSpec WORKLOADS[] = {
+	{ "add_heavy",    0.73, 0.20, 0.05, 0.02,    10'000,    8.0,   1,   0.0 },
+	{ "cancel_heavy", 0.45, 0.50, 0.03, 0.02,    50'000,    8.0,   1,   0.0 },
+	{ "modify_heavy", 0.30, 0.25, 0.43, 0.02,    50'000,    8.0,   1,   0.0 },
+	{ "deep_book",    0.47, 0.45, 0.05, 0.03, 1'000'000, 1000.0,   1,   0.0 },
+	{ "sparse_book",  0.47, 0.45, 0.05, 0.03,     2'000,    4.0, 500,   0.0 },
+	{ "poisson",      0.48, 0.47, 0.03, 0.02,    50'000,    8.0,   1, 200.0 },
+};
+
+enum OpKind : size_t { OP_ADD, OP_TAKE, OP_CANCEL, OP_MODIFY, OP_KINDS };
+constexpr const char* OP_NAMES[OP_KINDS] = { "add", "take", "cancel", "modify" };
+
+struct Workload
+{
+	std::vector<MarketEvent> prefill;
+	std::vector<MarketEvent> events;
+	std::vector<uint8_t> kinds;      // OpKind per event
+	std::vector<uint64_t> gaps_ns;   // inter-arrival gap per event (Poisson only)
+};
+
+// Tracks what is resting in the shadow book so the generator only cancels
+// and modifies live orders.
+class FlowGenerator : public IOrderBookListener
+{
+private:
+	struct Live
+	{
+		uint64_t id;
+		Price price;
+		Qty qty;
+		Side side;
+	};
+
+	const WorkloadSpec& spec_;
+	std::unique_ptr<Book> shadow_;
+	std::vector<Live> live_;
+	absl::flat_hash_map<uint64_t, size_t> slot_; // id -> index in live_
+	std::mt19937_64 rng_;
+	uint64_t next_id_ = 1;
+	Price mid_ = MID;
+	uint64_t taker_id_ = 0;  // add currently running through the shadow book
+	Qty taker_filled_ = 0;
+
+public:
+	explicit FlowGenerator(const WorkloadSpec& spec, uint64_t seed)
+		: spec_(spec),
+		  shadow_(std::make_unique<Book>(MID, MID, 1, POOL_CAPACITY)),
+		  rng_(seed)
+	{
+		shadow_->add_listener(this);
+		live_.reserve(spec.prefill * 2);
+	}
+
+	void on_book_update(const TopOfBook&) override {}
+
+	void on_trade(const Trade& trade) override
+	{
+		if(trade.taker_order_id == taker_id_) taker_filled_ += trade.qty;
+
+		auto it = slot_.find(trade.maker_order_id);
+		if(it == slot_.end()) return;
+
+		Live& l = live_[it->second];
+		l.qty -= std::min(l.qty, trade.qty);
+		if(l.qty == 0) remove(it->second);
+	}
+
+	Workload generate(size_t events)
+	{
+		Workload w;
+		w.prefill.reserve(spec_.prefill);
+		w.events.reserve(events);
+		w.kinds.reserve(events);
+
+		for(size_t i=0; i<spec_.prefill; i++) w.prefill.push_back(passive_add());
+
+		std::exponential_distribution<double> gap(spec_.mean_gap_ns > 0 ? 1.0 / spec_.mean_gap_ns : 1.0);
+		const double total = spec_.add + spec_.cancel + spec_.modify + spec_.take;
+
+		for(size_t i=0; i<events; i++)
+		{
+			if(i % 1024 == 0) drift();
+
+			const double r = uniform() * total;
+			OpKind kind = OP_ADD;
+			if(r < spec_.add) kind = OP_ADD;
+			else if(r < spec_.add + spec_.cancel) kind = OP_CANCEL;
+			else if(r < spec_.add + spec_.cancel + spec_.modify) kind = OP_MODIFY;
+			else kind = OP_TAKE;
+
+			if(live_.empty() && (kind == OP_CANCEL || kind == OP_MODIFY)) kind = OP_ADD;
+
+			MarketEvent ev{};
+			switch(kind)
+			{
+			case OP_ADD: ev = passive_add(); break;
+			case OP_TAKE: ev = take(); break;
+			case OP_CANCEL: ev = cancel(); break;
+			case OP_MODIFY: ev = modify(); break;
+			default: break;
+			}
+
+			w.events.push_back(ev);
+			w.kinds.push_back(static_cast<uint8_t>(kind));
+			if(spec_.mean_gap_ns > 0) w.gaps_ns.push_back(static_cast<uint64_t>(gap(rng_)));
+		}
+		return w;
+	}
+
+private:
+	double uniform() { return std::uniform_real_distribution<double>(0.0, 1.0)(rng_); }
+
+	Qty lot() { return static_cast<Qty>(1 + rng_() % 10) * 100; }
+
+	void drift()
+	{
+		const auto step = static_cast<Price>(spec_.level_spacing);
+		if(rng_() & 1) mid_ += step;
+		else mid_ -= step;
+	}
+
+	MarketEvent apply(const MarketEvent& ev)
+	{
+		shadow_->on_event(ev);
+		return ev;
+	}
+
+	// runs an add through the shadow book and tracks whatever part of it rests
+	MarketEvent add(Side side, Price price)
+	{
+		const MarketEvent ev{ .order_id = next_id_++, .price = price, .qty = lot(), .type = EventType::Add, .side = side };
+
+		taker_id_ = ev.order_id;
+		taker_filled_ = 0;
+		if(shadow_->add_order(ev.order_id, ev.price, ev.qty, ev.side) == AddResult::Rested)
+		{
+			slot_[ev.order_id] = live_.size();
+			live_.push_back({ ev.order_id, ev.price, ev.qty - taker_filled_, ev.side });
+		}
+		return ev;
+	}
+
+	MarketEvent passive_add()
+	{
+		const Side side = (rng_() & 1) ? Side::BID : Side::ASK;
+		std::exponential_distribution<double> dist(1.0 / spec_.depth_scale);
+		const auto levels = static_cast<Price>(1 + static_cast<Price>(dist(rng_)));
+		const Price offset = levels * spec_.level_spacing;
+		return add(side, side == Side::BID ? mid_ - offset : mid_ + offset);
+	}
+
+	MarketEvent take()
+	{
+		const Side side = (rng_() & 1) ? Side::BID : Side::ASK;
+		const Price touch = side == Side::BID ? shadow_->best_ask() : shadow_->best_bid();
+		if(touch == INVALID_PRICE) return passive_add();
+
+		const Price through = 2 * spec_.level_spacing;
+		return add(side, side == Side::BID ? touch + through : touch - through);
+	}
+
+	MarketEvent cancel()
+	{
+		const size_t i = rng_() % live_.size();
+		const Live l = live_[i];
+		remove(i);
+		return apply({ .order_id = l.id, .price = l.price, .qty = 0, .type = EventType::Cancel, .side = l.side });
+	}
+
+	MarketEvent modify()
+	{
+		Live& l = live_[rng_() % live_.size()];
+		l.qty = lot();
+		return apply({ .order_id = l.id, .price = l.price, .qty = l.qty, .type = EventType::Modify, .side = l.side });
+	}
+
+	void remove(size_t i)
+	{
+		slot_.erase(live_[i].id);
+		if(i + 1 != live_.size())
+		{
+			live_[i] = live_.back();
+			slot_[live_[i].id] = i;
+		}
+		live_.pop_back();
+	}
+};
+
+struct OpStats
+{
+	std::vector<uint64_t> cycles;
+};
+
+struct Result
+{
+	const char* name;
+	size_t events;
+	double ops_per_sec;
+	std::array<OpStats, OP_KINDS> ops;
+};
+
+double percentile_ns(const std::vector<uint64_t>& sorted, double p, double ghz)
+{
+	if(sorted.empty()) return 0.0;
+	size_t idx = static_cast<size_t>(p * static_cast<double>(sorted.size()));
+	return cycles_to_ns(sorted[std::min(idx, sorted.size() - 1)], ghz);
+}
+
+Result run_workload(const WorkloadSpec& spec, size_t events, double ghz)
+{
+	const size_t warmup = events / 10;
+
+	FlowGenerator gen(spec, 0x5eed);
+	const Workload w = gen.generate(warmup + events);
+
+	Result result{ spec.name, events, 0.0, {} };
+	for(auto& op : result.ops) op.cycles.reserve(events);
+
+	// latency pass
+	{
+		auto book = std::make_unique<Book>(MID, MID, 1, POOL_CAPACITY);
+		book->on_events(w.prefill);
+
+		uint64_t due = rdtsc_now();
+
+		for(size_t i=0; i<w.events.size(); i++)
+		{
+			if(!w.gaps_ns.empty())
+			{
+				due += static_cast<uint64_t>(double(w.gaps_ns[i]) * ghz);
+				while(rdtsc_now() < due) _mm_pause();
+			}
+
+			uint64_t t0 = rdtsc_now();
+			book->on_event(w.events[i]);
+			uint64_t t1 = rdtsc_now();
+
+			if(i >= warmup) result.ops[w.kinds[i]].cycles.push_back(t1 - t0);
+		}
+	}
+
+	// throughput pass
+	{
+		auto book = std::make_unique<Book>(MID, MID, 1, POOL_CAPACITY);
+		book->on_events(w.prefill);
+
+		const uint64_t t0 = monotonic_raw_ns();
+		book->on_events(w.events);
+		const uint64_t t1 = monotonic_raw_ns();
+
+		result.ops_per_sec = static_cast<double>(w.events.size()) * 1e9 / static_cast<double>(t1 - t0);
+	}
+
+	for(auto& op : result.ops) std::sort(op.cycles.begin(), op.cycles.end());
+	return result;
+}
+
+void print_result(const Result& r, double ghz)
+{
+	std::printf("%s: %.0f ops/sec\n", r.name, r.ops_per_sec);
+	std::printf("  %-7s %10s %8s %8s %8s %8s %10s\n", "op", "count", "p50", "p90", "p99", "p999", "max (ns)");
+
+	for(size_t k=0; k<OP_KINDS; k++)
+	{
+		const auto& c = r.ops[k].cycles;
+		if(c.empty()) continue;
+		std::printf("  %-7s %10zu %8.0f %8.0f %8.0f %8.0f %10.0f\n", OP_NAMES[k], c.size(),
+			percentile_ns(c, 0.50, ghz), percentile_ns(c, 0.90, ghz), percentile_ns(c, 0.99, ghz),
+			percentile_ns(c, 0.999, ghz), cycles_to_ns(c.back(), ghz));
+	}
+}
+
+// log2 buckets over nanoseconds: bucket b counts samples in [2^b, 2^(b+1))
+std::array<uint64_t, 40> histogram_ns(const std::vector<uint64_t>& cycles, double ghz)
+{
+	std::array<uint64_t, 40> buckets{};
+	for(uint64_t c : cycles)
+	{
+		const auto ns = static_cast<uint64_t>(cycles_to_ns(c, ghz));
+		const size_t b = ns == 0 ? 0 : static_cast<size_t>(std::bit_width(ns) - 1);
+		buckets[std::min(b, buckets.size() - 1)]++;
+	}
+	return buckets;
+}
+
+void write_json(const std::string& path, const std::vector<Result>& results, double ghz)
+{
+	std::ofstream out(path);
+	out << "{\n  \"tsc_ghz\": " << ghz << ",\n  \"workloads\": [\n";
+
+	for(size_t i=0; i<results.size(); i++)
+	{
+		const Result& r = results[i];
+		out << "    {\n      \"name\": \"" << r.name << "\",\n"
+			<< "      \"events\": " << r.events << ",\n"
+			<< "      \"ops_per_sec\": " << r.ops_per_sec << ",\n"
+			<< "      \"ops\": {";
+
+		bool first = true;
+		for(size_t k=0; k<OP_KINDS; k++)
+		{
+			const auto& c = r.ops[k].cycles;
+			if(c.empty()) continue;
+
+			out << (first ? "\n" : ",\n") << "        \"" << OP_NAMES[k] << "\": { "
+				<< "\"count\": " << c.size()
+				<< ", \"p50_ns\": " << percentile_ns(c, 0.50, ghz)
+				<< ", \"p90_ns\": " << percentile_ns(c, 0.90, ghz)
+				<< ", \"p99_ns\": " << percentile_ns(c, 0.99, ghz)
+				<< ", \"p999_ns\": " << percentile_ns(c, 0.999, ghz)
+				<< ", \"max_ns\": " << cycles_to_ns(c.back(), ghz)
+				<< ", \"log2_ns_histogram\": [";
+
+			const auto buckets = histogram_ns(c, ghz);
+			for(size_t b=0; b<buckets.size(); b++) out << (b ? ", " : "") << buckets[b];
+			out << "] }";
+			first = false;
+		}
+		out << "\n      }\n    }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	std::string only;
+	std::string json_path;
+	size_t events = 2'000'000;
+
+	for(int i=1; i<argc; i++)
+	{
+		if(!std::strcmp(argv[i], "--workload") && i + 1 < argc) only = argv[++i];
+		else if(!std::strcmp(argv[i], "--events") && i + 1 < argc) events = std::stoull(argv[++i]);
+		else if(!std::strcmp(argv[i], "--json") && i + 1 < argc) json_path = argv[++i];
+		else
+		{
+			std::cerr << "usage: " << argv[0] << " [--workload NAME] [--events N] [--json FILE]\n";
+			return 1;
+		}
+	}
+
+	const double ghz = calibrate_ghz();
+	std::vector<Result> results;
+
+	for(const WorkloadSpec& spec : WORKLOADS)
+	{
+		if(!only.empty() && only != spec.name) continue;
+		results.push_back(run_workload(spec, events, ghz));
+		print_result(results.back(), ghz);
+	}
+
+	if(results.empty())
+	{
+		std::cerr << "unknown workload: " << only << "\n";
+		return 1;
+	}
+
+	if(!json_path.empty()) write_json(json_path, results, ghz);
+	return 0;
 }
@@ -0,0 +1,144 @@
+#include "book_side.hpp"
+#include "lat_helper.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Depth analytics over 64 occupied levels per side, the way the pricing model
+// queries them every tick: level-by-level through get_depth() versus the
+// depth_kernels scans over the SoA quantity ring, for a book with a level on
+// every tick and for one with a level every fourth tick.
+
+namespace {
+
+constexpr size_t LEVELS = 64;
+constexpr size_t WARMUP = 10'000;
+constexpr size_t ITERATIONS = 200'000;
+constexpr Price MID = 100'000;
+
+// keeps the optimiser from dropping a result
+volatile uint64_t sink;
+
+void report(const char* name, std::vector<uint64_t>& samples, double ghz)
+{
+	std::sort(samples.begin(), samples.end());
+	auto pct = [&](double p)
+	{
+		size_t idx = static_cast<size_t>(p * static_cast<double>(samples.size()));
+		return cycles_to_ns(samples[std::min(idx, samples.size() - 1)], ghz);
+	};
+
+	std::cout << name << "\n";
+	std::cout << "  P50  : " << pct(0.50) << " ns\n";
+	std::cout << "  P99  : " << pct(0.99) << " ns\n";
+	std::cout << "  P999 : " << pct(0.999) << " ns\n";
+}
+
+template <typename F>
+void measure(const char* name, double ghz, F&& f)
+{
+	std::vector<uint64_t> samples;
+	samples.reserve(ITERATIONS);
+
+	for(size_t i=0; i<WARMUP + ITERATIONS; i++)
+	{
+		uint64_t t0 = rdtsc_now();
+		sink = f();
+		uint64_t t1 = rdtsc_now();
+		if(i >= WARMUP) samples.push_back(t1 - t0);
+	}
+
+	report(name, samples, ghz);
+}
+
+void bench_book(const char* label, Price spacing, double ghz)
+{
+	OrderPool pool(LEVELS * 2);
+	auto bid_side = std::make_unique<BookSide<Side::BID, MAX_PRICE_LEVELS>>(MID, 1, pool);
+	auto ask_side = std::make_unique<BookSide<Side::ASK, MAX_PRICE_LEVELS>>(MID, 1, pool);
+	bid_side->recenter(MID);
+	ask_side->recenter(MID);
+
+	std::mt19937 rng(7);
+	uint64_t ask_total = 0;
+
+	for(size_t i=0; i<LEVELS; i++)
+	{
+		const Price offset = 1 + static_cast<Price>(i) * spacing;
+
+		Order* bid = pool.allocate();
+		bid->quantity = 100 + static_cast<Qty>(rng() % 900);
+		bid_side->add_order(bid, MID - offset);
+
+		Order* ask = pool.allocate();
+		ask->quantity = 100 + static_cast<Qty>(rng() % 900);
+		ask_side->add_order(ask, MID + offset);
+		ask_total += ask->quantity;
+	}
+
+	const uint32_t window = static_cast<uint32_t>(LEVELS * spacing);
+	const uint64_t sweep_qty = ask_total * 3 / 4;
+	std::cout << "--- " << label << " (" << depth_kernels::ISA << ") ---\n";
+
+	// the per-level baseline copies every level out, then reduces
+	std::vector<DepthLevel> bids(LEVELS);
+	std::vector<DepthLevel> asks(LEVELS);
+
+	measure("imbalance over 64 levels, get_depth", ghz, [&]
+	{
+		size_t nb = 0;
+		size_t na = 0;
+		bid_side->get_depth(bids.data(), LEVELS, nb);
+		ask_side->get_depth(asks.data(), LEVELS, na);
+
+		uint64_t b = 0;
+		uint64_t a = 0;
+		for(size_t i=0; i<nb; i++) b += bids[i].qty;
+		for(size_t i=0; i<na; i++) a += asks[i].qty;
+		return (b * 1000) / (b + a);
+	});
+
+	measure("imbalance over 64 levels, depth_within", ghz, [&]
+	{
+		const uint64_t b = bid_side->depth_within(window);
+		const uint64_t a = ask_side->depth_within(window);
+		return (b * 1000) / (b + a);
+	});
+
+	measure("VWAP to 3/4 of the asks, get_depth", ghz, [&]
+	{
+		size_t na = 0;
+		ask_side->get_depth(asks.data(), LEVELS, na);
+
+		uint64_t filled = 0;
+		uint64_t notional = 0;
+		for(size_t i=0; i<na && filled < sweep_qty; i++)
+		{
+			const uint64_t take = std::min<uint64_t>(asks[i].qty, sweep_qty - filled);
+			filled += take;
+			notional += take * asks[i].price;
+		}
+		return notional / filled;
+	});
+
+	measure("VWAP to 3/4 of the asks, estimate_sweep", ghz, [&]
+	{
+		const FillEstimate est = ask_side->estimate_sweep(sweep_qty);
+		return est.notional / est.filled;
+	});
+}
+
+} // namespace
+
+int main()
+{
+	double ghz = calibrate_ghz();
+
+	bench_book("level every tick", 1, ghz);
+	bench_book("level every 4 ticks", 4, ghz);
+
+	return 0;
+}
@@ -0,0 +1,89 @@
+#include "feed_arbiter.hpp"
+#include "lat_helper.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Cost of A/B line arbitration per packet: both lines interleaved, line A
+// dropping about 1% of packets and line B delivering some out of order, so
+// the arbiter sees duplicates, reorder-window hits and the clean in-order
+// case in realistic proportions.
+
+namespace {
+
+constexpr uint64_t EVENTS = 2'000'000;
+constexpr size_t ROUNDS = 5;
+
+// a sink that keeps the events from being optimised away
+struct Checksum
+{
+	uint64_t sum = 0;
+	void operator()(const MarketEvent& ev) noexcept { sum += ev.order_id; }
+};
+
+std::vector<SequencedEvent> make_packets()
+{
+	std::mt19937_64 rng(5);
+	std::vector<SequencedEvent> a;
+	std::vector<SequencedEvent> b;
+	a.reserve(EVENTS);
+	b.reserve(EVENTS);
+
+	for(uint64_t seq=1; seq<=EVENTS; seq++)
+	{
+		const SequencedEvent packet{ .seq = seq, .ev = { .order_id = seq, .price = 0, .qty = 0, .type = EventType::Add, .side = Side::BID } };
+		if(rng() % 100 != 0) a.push_back(packet);
+		b.push_back(packet);
+	}
+	for(size_t i=0; i+4<b.size(); i++)
+	{
+		if(rng() % 50 == 0) std::swap(b[i], b[i + 1 + rng() % 3]);
+	}
+
+	// B trails A by a few packets, as the slower line would
+	std::vector<SequencedEvent> packets;
+	packets.reserve(a.size() + b.size());
+	size_t j = 0;
+	for(size_t i=0; i<a.size(); i++)
+	{
+		packets.push_back(a[i]);
+		while(j < b.size() && b[j].seq + 4 <= a[i].seq) packets.push_back(b[j++]);
+	}
+	while(j < b.size()) packets.push_back(b[j++]);
+	return packets;
+}
+
+} // namespace
+
+int main()
+{
+	double ghz = calibrate_ghz();
+	const std::vector<SequencedEvent> packets = make_packets();
+	std::vector<double> ns_per_packet;
+
+	for(size_t round=0; round<ROUNDS; round++)
+	{
+		FeedArbiter<> arbiter;
+		Checksum sink;
+
+		uint64_t t0 = rdtsc_now();
+		for(const SequencedEvent& packet : packets) arbiter.on_packet(packet, sink);
+		arbiter.flush(sink);
+		uint64_t t1 = rdtsc_now();
+
+		ns_per_packet.push_back(cycles_to_ns(t1 - t0, ghz) / static_cast<double>(packets.size()));
+		if(round == 0)
+		{
+			std::cout << packets.size() << " packets: " << arbiter.duplicates() << " duplicates, "
+					  << arbiter.reordered() << " reordered, " << arbiter.lost() << " lost"
+					  << " (checksum " << sink.sum << ")\n";
+		}
+	}
+
+	std::sort(ns_per_packet.begin(), ns_per_packet.end());
+	std::cout << "arbitration: " << ns_per_packet[ROUNDS / 2] << " ns/packet (median of " << ROUNDS << ")\n";
+
+	return 0;
+}
@@ -0,0 +1,116 @@
+#include "order_book.hpp"
+#include "lat_helper.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Cost of listener fan-out: the same event stream through a book with three
+// sinks registered at run time (a vector of virtual listeners) and through
+// one with the same sinks fixed at compile time in a StaticListeners pack.
+// Every sink takes every callback, so each event fans out to a trade, delta
+// and BBO call per sink.
+
+namespace {
+
+constexpr size_t EVENTS = 2'000'000;
+constexpr size_t ROUNDS = 5;
+constexpr Price MID = 100'000;
+
+// what a cheap real sink does: fold the callback into some state
+struct Tally
+{
+	uint64_t sum = 0;
+
+	void on_book_update(const TopOfBook& update) noexcept { sum += update.best_bid_qty; }
+	void on_trade(const Trade& trade) noexcept { sum += trade.qty; }
+	void on_delta(const BookDelta& delta) noexcept { sum += delta.qty; }
+};
+
+struct VirtualTally final : IOrderBookListener
+{
+	Tally tally;
+
+	void on_book_update(const TopOfBook& update) override { tally.on_book_update(update); }
+	void on_trade(const Trade& trade) override { tally.on_trade(trade); }
+	void on_delta(const BookDelta& delta) override { tally.on_delta(delta); }
+};
+
+template <int>
+struct TallyN : Tally {};
+
+struct StaticTraits : DefaultBookTraits
+{
+	using Listeners = StaticListeners<TallyN<0>, TallyN<1>, TallyN<2>>;
+};
+
+std::vector<MarketEvent> make_events()
+{
+	std::vector<MarketEvent> events;
+	events.reserve(EVENTS);
+	std::mt19937_64 rng(11);
+	std::vector<uint64_t> live;
+	uint64_t next_id = 1;
+
+	for(size_t i=0; i<EVENTS; i++)
+	{
+		if(live.empty() || rng() % 2 == 0)
+		{
+			const bool bid = rng() % 2 == 0;
+			const Price offset = static_cast<Price>(rng() % 32);
+			// a few adds cross the touch to produce trades
+			const Price price = bid ? MID - offset + 2 : MID + offset - 2;
+			events.push_back({ .order_id = next_id, .price = price, .qty = 1 + static_cast<Qty>(rng() % 50), .type = EventType::Add, .side = bid ? Side::BID : Side::ASK });
+			live.push_back(next_id++);
+		}
+		else
+		{
+			const size_t k = rng() % live.size();
+			events.push_back({ .order_id = live[k], .price = 0, .qty = 0, .type = EventType::Cancel, .side = Side::BID });
+			live[k] = live.back();
+			live.pop_back();
+		}
+	}
+	return events;
+}
+
+template <typename Book, typename Setup>
+void bench(const char* name, const std::vector<MarketEvent>& events, double ghz, Setup&& setup)
+{
+	std::vector<double> ns_per_event;
+
+	for(size_t round=0; round<ROUNDS; round++)
+	{
+		auto book = std::make_unique<Book>(MID, MID, 1, EVENTS);
+		setup(*book);
+
+		uint64_t t0 = rdtsc_now();
+		book->on_events(events);
+		uint64_t t1 = rdtsc_now();
+
+		ns_per_event.push_back(cycles_to_ns(t1 - t0, ghz) / static_cast<double>(events.size()));
+	}
+
+	std::sort(ns_per_event.begin(), ns_per_event.end());
+	std::cout << name << ": " << ns_per_event[ROUNDS / 2] << " ns/event (median of " << ROUNDS << ")\n";
+}
+
+} // namespace
+
+int main()
+{
+	double ghz = calibrate_ghz();
+	const std::vector<MarketEvent> events = make_events();
+
+	VirtualTally sinks[3];
+	bench<OrderBook<>>("3 listeners, DynamicListeners", events, ghz, [&](OrderBook<>& book)
+	{
+		for(auto& sink : sinks) book.add_listener(&sink);
+	});
+
+	bench<OrderBook<StaticTraits>>("3 listeners, StaticListeners", events, ghz, [](OrderBook<StaticTraits>&) {});
+
+	return 0;
+}
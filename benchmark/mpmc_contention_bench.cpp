@@ -0,0 +1,152 @@
+#include "mpmc.hpp"
+#include "sharded_mpsc.hpp"
+#include "lat_helper.hpp"
+#include "market_event.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <immintrin.h>
+
+// Several feed-handler threads into one book thread: throughput for 1..N
+// producers through mpmc push/pop, mpmc try_push_n/try_pop_n and a
+// sharded_mpsc. The consumer checks that each producer's events arrive in
+// the order they were pushed. N defaults to one less than the core count
+// and can be given as the first argument.
+
+namespace {
+
+constexpr size_t QSIZE = 1 << 14;
+constexpr uint64_t MESSAGES = 8'000'000;
+constexpr size_t BATCH = 32;
+constexpr int PRODUCER_SHIFT = 48;
+
+MarketEvent make_event(size_t producer, uint64_t seq)
+{
+	MarketEvent ev{};
+	ev.order_id = (uint64_t(producer) << PRODUCER_SHIFT) | seq;
+	return ev;
+}
+
+// Runs `producers` threads calling send(producer, first_seq, count) and the
+// consumer loop recv(out, max) on this thread; returns millions of events/s.
+template <typename Send, typename Recv>
+double run(size_t producers, Send&& send, Recv&& recv)
+{
+	const uint64_t per_producer = MESSAGES / producers;
+	std::atomic<size_t> started{0};
+	std::vector<std::thread> threads;
+
+	for(size_t p=0; p<producers; p++)
+	{
+		threads.emplace_back([&, p]()
+		{
+			pin_thread_to_core(static_cast<int>(p) + 1);
+			started.fetch_add(1);
+			while(started.load() != producers + 1) _mm_pause();
+			send(p, per_producer);
+		});
+	}
+
+	pin_thread_to_core(0);
+	std::vector<uint64_t> next(producers, 0);
+	MarketEvent batch[BATCH];
+	const uint64_t total = per_producer * producers;
+
+	while(started.load() != producers) _mm_pause();
+	const uint64_t t0 = monotonic_raw_ns();
+	started.fetch_add(1);
+
+	for(uint64_t got=0; got<total;)
+	{
+		const size_t n = recv(batch, BATCH);
+		if(n == 0) { _mm_pause(); continue; }
+		for(size_t i=0; i<n; i++)
+		{
+			const size_t p = batch[i].order_id >> PRODUCER_SHIFT;
+			const uint64_t seq = batch[i].order_id & ((uint64_t(1) << PRODUCER_SHIFT) - 1);
+			if(seq != next[p]++)
+			{
+				std::cerr << "producer " << p << " out of order\n";
+				std::exit(1);
+			}
+		}
+		got += n;
+	}
+
+	const uint64_t t1 = monotonic_raw_ns();
+	for(auto& t : threads) t.join();
+	return double(total) * 1e3 / double(t1 - t0);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const size_t max_producers = argc > 1
+		? static_cast<size_t>(std::atoi(argv[1]))
+		: static_cast<size_t>(cpu_count > 1 ? cpu_count - 1 : 1);
+
+	std::cout << "producers  mpmc push/pop  mpmc try_push_n/try_pop_n  sharded_mpsc  (M events/s)\n";
+
+	for(size_t producers=1; producers<=max_producers; producers++)
+	{
+		double single;
+		{
+			mpmc<MarketEvent> q(QSIZE);
+			single = run(producers,
+				[&](size_t p, uint64_t count)
+				{
+					for(uint64_t s=0; s<count; s++)
+					{
+						while(!q.push(make_event(p, s))) _mm_pause();
+					}
+				},
+				[&](MarketEvent* out, size_t) { return q.pop(out[0]) ? size_t(1) : size_t(0); });
+		}
+
+		double bulk;
+		{
+			mpmc<MarketEvent> q(QSIZE);
+			bulk = run(producers,
+				[&](size_t p, uint64_t count)
+				{
+					MarketEvent batch[BATCH];
+					for(uint64_t s=0; s<count;)
+					{
+						const size_t n = count - s < BATCH ? static_cast<size_t>(count - s) : BATCH;
+						for(size_t i=0; i<n; i++) batch[i] = make_event(p, s + i);
+						size_t done = 0;
+						while(done < n)
+						{
+							const size_t pushed = q.try_push_n(batch + done, n - done);
+							if(pushed == 0) _mm_pause();
+							done += pushed;
+						}
+						s += n;
+					}
+				},
+				[&](MarketEvent* out, size_t max) { return q.try_pop_n(out, max); });
+		}
+
+		double sharded;
+		{
+			sharded_mpsc<MarketEvent> q(producers, QSIZE);
+			sharded = run(producers,
+				[&](size_t p, uint64_t count)
+				{
+					for(uint64_t s=0; s<count; s++)
+					{
+						while(!q.push(p, make_event(p, s))) _mm_pause();
+					}
+				},
+				[&](MarketEvent* out, size_t max) { return q.pop_n(out, max); });
+		}
+
+		std::cout << producers << "          " << single << "          " << bulk << "          " << sharded << "\n";
+	}
+
+	return 0;
+}
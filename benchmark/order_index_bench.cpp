@@ -0,0 +1,93 @@
+#include "order_book.hpp"
+#include "lat_helper.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Cancel latency with dense, increasing order ids: hash map index versus the
+// direct-mapped table. Orders rest on 512 levels around the mid and are
+// cancelled in random order so lookups do not just walk memory linearly.
+
+namespace {
+
+constexpr uint64_t FIRST_ID = 1'000'000;
+constexpr size_t ORDERS = 1'000'000;
+constexpr size_t ROUNDS = 5;
+constexpr Price MID = 100'000;
+
+void report(const char* name, std::vector<uint64_t>& samples, double ghz)
+{
+	std::sort(samples.begin(), samples.end());
+	auto pct = [&](double p)
+	{
+		size_t idx = static_cast<size_t>(p * static_cast<double>(samples.size()));
+		return cycles_to_ns(samples[std::min(idx, samples.size() - 1)], ghz);
+	};
+
+	std::cout << name << "\n";
+	std::cout << "  P50  : " << pct(0.50) << " ns\n";
+	std::cout << "  P99  : " << pct(0.99) << " ns\n";
+	std::cout << "  P999 : " << pct(0.999) << " ns\n";
+}
+
+template <typename I>
+struct IndexTraits : DefaultBookTraits
+{
+	using Index = I;
+};
+
+template <typename Index>
+void bench_cancel(const char* name, Index index, double ghz)
+{
+	OrderPoolConfig pool_config{ .initial_capacity = ORDERS };
+	auto book = std::make_unique<OrderBook<IndexTraits<Index>>>(MID, MID, 1, pool_config, std::move(index));
+
+	std::vector<uint64_t> ids(ORDERS);
+	std::vector<uint64_t> samples;
+	samples.reserve(ORDERS * ROUNDS);
+
+	std::mt19937_64 rng(42);
+	uint64_t next_id = FIRST_ID;
+
+	for(size_t round=0; round<ROUNDS; round++)
+	{
+		for(size_t i=0; i<ORDERS; i++)
+		{
+			const bool bid = (i & 1) == 0;
+			const Price offset = 1 + static_cast<Price>(rng() % 256);
+			ids[i] = next_id++;
+			book->add_order(ids[i], bid ? MID - offset : MID + offset, 10, bid ? Side::BID : Side::ASK);
+		}
+
+		std::vector<size_t> order(ORDERS);
+		std::iota(order.begin(), order.end(), 0);
+		std::shuffle(order.begin(), order.end(), rng);
+
+		for(size_t i : order)
+		{
+			uint64_t t0 = rdtsc_now();
+			book->cancel_order(ids[i]);
+			uint64_t t1 = rdtsc_now();
+			samples.push_back(t1 - t0);
+		}
+	}
+
+	report(name, samples, ghz);
+}
+
+} // namespace
+
+int main()
+{
+	double ghz = calibrate_ghz();
+
+	bench_cancel("cancel, HashOrderIndex", HashOrderIndex{}, ghz);
+	bench_cancel("cancel, HashOrderIndex (reserved)", HashOrderIndex{ORDERS}, ghz);
+	bench_cancel("cancel, DirectOrderIndex", DirectOrderIndex{FIRST_ID, ORDERS * ROUNDS}, ghz);
+
+	return 0;
+}
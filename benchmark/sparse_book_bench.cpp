@@ -0,0 +1,119 @@
+#include "book_side.hpp"
+#include "lat_helper.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Best-level recovery on a thin book: a handful of levels spread far apart
+// across the ladder, so every cancel of the best order has to find the next
+// occupied level across thousands of empty ones.
+
+namespace {
+
+constexpr size_t LEVELS = 8;
+constexpr Price GAP_TICKS = 12'000;
+constexpr size_t WARMUP = 10'000;
+constexpr size_t ITERATIONS = 200'000;
+
+template <typename Book>
+void populate(Book& book, OrderPool& pool, Order** orders, Price base)
+{
+	for(size_t i=0; i<LEVELS; i++)
+	{
+		orders[i] = pool.allocate();
+		orders[i]->order_id = i;
+		orders[i]->quantity = 10;
+		book.add_order(orders[i], base + static_cast<Price>(i) * GAP_TICKS);
+	}
+}
+
+void report(const char* name, std::vector<uint64_t>& samples, double ghz)
+{
+	std::sort(samples.begin(), samples.end());
+	auto pct = [&](double p)
+	{
+		size_t idx = static_cast<size_t>(p * static_cast<double>(samples.size()));
+		return cycles_to_ns(samples[std::min(idx, samples.size() - 1)], ghz);
+	};
+
+	std::cout << name << "\n";
+	std::cout << "  P50  : " << pct(0.50) << " ns\n";
+	std::cout << "  P99  : " << pct(0.99) << " ns\n";
+	std::cout << "  P999 : " << pct(0.999) << " ns\n";
+	std::cout << "  Max  : " << cycles_to_ns(samples.back(), ghz) << " ns\n";
+}
+
+template <Side S>
+void bench_recovery(const char* name, double ghz)
+{
+	using Book = BookSide<S, MAX_PRICE_LEVELS>;
+	constexpr Price BASE = 1000;
+
+	OrderPool pool(LEVELS);
+	auto book = std::make_unique<Book>(BASE, 1, pool);
+	Order* orders[LEVELS];
+	populate(*book, pool, orders, BASE);
+
+	// bids lose their highest level, asks their lowest
+	Order* best = (S == Side::BID) ? orders[LEVELS - 1] : orders[0];
+	const Price best_price = book->get_best_price();
+
+	std::vector<uint64_t> samples;
+	samples.reserve(ITERATIONS);
+
+	for(size_t i=0; i<WARMUP + ITERATIONS; i++)
+	{
+		uint64_t t0 = rdtsc_now();
+		book->remove_order(best);
+		uint64_t t1 = rdtsc_now();
+
+		book->add_order(best, best_price);
+		if(i >= WARMUP) samples.push_back(t1 - t0);
+	}
+
+	report(name, samples, ghz);
+}
+
+template <Side S>
+void bench_depth(const char* name, double ghz)
+{
+	using Book = BookSide<S, MAX_PRICE_LEVELS>;
+	constexpr Price BASE = 1000;
+
+	OrderPool pool(LEVELS);
+	auto book = std::make_unique<Book>(BASE, 1, pool);
+	Order* orders[LEVELS];
+	populate(*book, pool, orders, BASE);
+
+	DepthLevel out[5];
+	size_t count = 0;
+	std::vector<uint64_t> samples;
+	samples.reserve(ITERATIONS);
+
+	for(size_t i=0; i<WARMUP + ITERATIONS; i++)
+	{
+		uint64_t t0 = rdtsc_now();
+		book->get_depth(out, 5, count);
+		uint64_t t1 = rdtsc_now();
+
+		if(i >= WARMUP) samples.push_back(t1 - t0);
+	}
+
+	report(name, samples, ghz);
+}
+
+} // namespace
+
+int main()
+{
+	double ghz = calibrate_ghz();
+
+	bench_recovery<Side::BID>("cancel best bid (sparse)", ghz);
+	bench_recovery<Side::ASK>("cancel best ask (sparse)", ghz);
+	bench_depth<Side::BID>("get_depth(5) bids (sparse)", ghz);
+	bench_depth<Side::ASK>("get_depth(5) asks (sparse)", ghz);
+
+	return 0;
+}
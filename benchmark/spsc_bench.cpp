@@ -0,0 +1,106 @@
+#include "spsc.hpp"
+#include "lat_helper.hpp"
+#include "market_event.hpp"
+
+#include <iostream>
+#include <thread>
+#include <immintrin.h>
+
+// Feed-handler -> book-thread hand-off: ns per MarketEvent across two pinned
+// cores, for single push/pop, batched push_n/pop_n and zero-copy front/consume.
+
+namespace {
+
+constexpr size_t QSIZE = 1 << 14;
+constexpr uint64_t MESSAGES = 20'000'000;
+constexpr size_t BATCH = 32;
+
+template <typename Consume>
+void run(const char* name, bool batched_producer, Consume&& consume_all)
+{
+	spsc<MarketEvent> q(QSIZE);
+
+	std::thread producer([&]()
+	{
+		pin_thread_to_core(2);
+		MarketEvent batch[BATCH]{};
+		uint64_t sent = 0;
+		while(sent < MESSAGES)
+		{
+			if(batched_producer)
+			{
+				for(size_t i=0; i<BATCH; i++) batch[i].order_id = sent + i;
+				size_t n = BATCH;
+				if(MESSAGES - sent < n) n = static_cast<size_t>(MESSAGES - sent);
+				size_t done = 0;
+				while(done < n) done += q.push_n(batch + done, n - done);
+				sent += n;
+			}
+			else
+			{
+				MarketEvent ev{};
+				ev.order_id = sent;
+				while(!q.push(ev)) _mm_pause();
+				sent++;
+			}
+		}
+	});
+
+	pin_thread_to_core(3);
+	const uint64_t t0 = monotonic_raw_ns();
+	const uint64_t checksum = consume_all(q);
+	const uint64_t t1 = monotonic_raw_ns();
+	producer.join();
+
+	std::cout << name << ": " << double(t1 - t0) / double(MESSAGES) << " ns/msg"
+			  << " (checksum " << checksum << ")\n";
+}
+
+} // namespace
+
+int main()
+{
+	run("push / pop", false, [](spsc<MarketEvent>& q)
+	{
+		uint64_t sum = 0;
+		MarketEvent ev{};
+		for(uint64_t got=0; got<MESSAGES;)
+		{
+			if(q.pop(ev)) { sum += ev.order_id; got++; }
+			else _mm_pause();
+		}
+		return sum;
+	});
+
+	run("push_n / pop_n", true, [](spsc<MarketEvent>& q)
+	{
+		uint64_t sum = 0;
+		MarketEvent batch[BATCH];
+		for(uint64_t got=0; got<MESSAGES;)
+		{
+			const size_t n = q.pop_n(batch, BATCH);
+			if(n == 0) { _mm_pause(); continue; }
+			for(size_t i=0; i<n; i++) sum += batch[i].order_id;
+			got += n;
+		}
+		return sum;
+	});
+
+	run("push_n / front+consume", true, [](spsc<MarketEvent>& q)
+	{
+		uint64_t sum = 0;
+		for(uint64_t got=0; got<MESSAGES;)
+		{
+			if(const MarketEvent* ev = q.front())
+			{
+				sum += ev->order_id;
+				q.consume();
+				got++;
+			}
+			else _mm_pause();
+		}
+		return sum;
+	});
+
+	return 0;
+}
@@ -0,0 +1,91 @@
+#include "spsc.hpp"
+#include "lat_helper.hpp"
+#include "market_event.hpp"
+#include "wait_strategy.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <time.h>
+
+// An illiquid symbol: one event every GAP_US, consumed through pop_wait() on
+// each wait strategy. Reports wake-up latency (push to pop, in TSC cycles
+// carried in the event) and the CPU time the consumer burned while waiting.
+
+namespace {
+
+constexpr size_t QSIZE = 1 << 10;
+constexpr size_t MESSAGES = 20'000;
+constexpr auto GAP = std::chrono::microseconds(200);
+
+uint64_t thread_cpu_ns()
+{
+	timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return uint64_t(ts.tv_sec) * 1'000'000'000ull + uint64_t(ts.tv_nsec);
+}
+
+template <typename Wait>
+void run(const char* name, double ghz)
+{
+	spsc<MarketEvent, std::allocator<MarketEvent>, Wait> q(QSIZE);
+	std::atomic<bool> done{false};
+	std::vector<uint64_t> samples;
+	samples.reserve(MESSAGES);
+	uint64_t consumer_cpu = 0;
+
+	std::thread consumer([&]()
+	{
+		pin_thread_to_core(3);
+		auto stop = [&]() { return done.load(std::memory_order_acquire); };
+		const uint64_t cpu0 = thread_cpu_ns();
+		MarketEvent ev{};
+		while(q.pop_wait(ev, stop))
+		{
+			samples.push_back(rdtsc_now() - ev.order_id);
+		}
+		consumer_cpu = thread_cpu_ns() - cpu0;
+	});
+
+	pin_thread_to_core(2);
+	const uint64_t t0 = monotonic_raw_ns();
+	for(size_t i=0; i<MESSAGES; i++)
+	{
+		std::this_thread::sleep_for(GAP);
+		MarketEvent ev{};
+		ev.order_id = rdtsc_now();
+		while(!q.push(ev)) _mm_pause();
+	}
+	done.store(true, std::memory_order_release);
+	q.notify();
+	consumer.join();
+	const uint64_t wall = monotonic_raw_ns() - t0;
+
+	std::sort(samples.begin(), samples.end());
+	auto pct = [&](double p)
+	{
+		size_t idx = static_cast<size_t>(p * static_cast<double>(samples.size()));
+		return cycles_to_ns(samples[std::min(idx, samples.size() - 1)], ghz);
+	};
+
+	std::cout << name << "\n";
+	std::cout << "  wake-up P50  : " << pct(0.50) << " ns\n";
+	std::cout << "  wake-up P99  : " << pct(0.99) << " ns\n";
+	std::cout << "  wake-up P999 : " << pct(0.999) << " ns\n";
+	std::cout << "  consumer CPU : " << 100.0 * double(consumer_cpu) / double(wall) << " % of a core\n";
+}
+
+} // namespace
+
+int main()
+{
+	double ghz = calibrate_ghz();
+
+	run<BusySpin>("BusySpin", ghz);
+	run<SpinYield<>>("SpinYield", ghz);
+	run<SpinPark<>>("SpinPark", ghz);
+
+	return 0;
+}
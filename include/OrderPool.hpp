@@ -3,11 +3,42 @@
 #include "types.hpp"
 
 #include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class OrderPool;
+
+enum class PoolExhaustionPolicy : uint8_t
+{
+    Grow,     // map another chunk (up to max_capacity)
+    Reject,   // allocate() returns nullptr
+    Callback  // ask on_exhausted; it may grow() and retry or give up
+};
+
+// Called when the free list is empty under PoolExhaustionPolicy::Callback.
+// Return true to retry the allocation (e.g. after calling pool.grow()).
+using PoolExhaustedFn = bool (*)(OrderPool& pool, void* ctx);
+
+struct OrderPoolConfig
+{
+    static constexpr size_t HUGE_PAGE_SIZE = 2u << 20;
+    static constexpr size_t DEFAULT_CHUNK_ORDERS = HUGE_PAGE_SIZE / sizeof(Order);
+
+    size_t initial_capacity = DEFAULT_CHUNK_ORDERS; // rounded up to whole chunks
+    size_t chunk_capacity = DEFAULT_CHUNK_ORDERS;   // orders per chunk, rounded up to a power of two
+    size_t max_capacity = 0;                        // 0 = unbounded
+    PoolExhaustionPolicy policy = PoolExhaustionPolicy::Grow;
+    bool huge_pages = false; // MAP_HUGETLB, falling back to madvise(MADV_HUGEPAGE)
+    bool prefault = true;    // touch every page up front instead of on first use
+    PoolExhaustedFn on_exhausted = nullptr;
+    void* on_exhausted_ctx = nullptr;
+};
 
 class OrderPool 
 {
 public:
     explicit OrderPool(size_t capacity);
+    explicit OrderPool(const OrderPoolConfig& config);
     ~OrderPool();
 
     OrderPool(const OrderPool& other) = delete;
@@ -16,11 +47,36 @@ public:
     Order* allocate();
     void deallocate(Order* order);
 
+    // Index -> Order, for the links inside price levels. Valid for any index
+    // the pool has handed out.
+    Order* at(uint32_t index) const noexcept
+    {
+        return chunks_[index >> chunk_shift_].orders + (index & chunk_mask_);
+    }
+
+    // Maps one more chunk and threads it onto the free list. Existing orders
+    // never move. Returns false at max_capacity or if the mapping fails.
+    bool grow();
+
     size_t capacity() const { return capacity_; };
     size_t available() const { return free_count_; }
+    size_t chunk_count() const { return chunks_.size(); }
+    size_t exhausted_count() const { return exhausted_count_; }
 private:
-    Order* storage_; // raw array
-    Order* free_list_; // head of free list
+    struct Chunk
+    {
+        Order* orders;
+        size_t bytes;
+    };
+
+    Order* allocate_slow();
+
+    OrderPoolConfig config_;
+    std::vector<Chunk> chunks_;
+    unsigned chunk_shift_;
+    uint32_t chunk_mask_;
+    uint32_t free_list_; // index of the head of the free list
     size_t capacity_;
     size_t free_count_;
+    size_t exhausted_count_;
 };
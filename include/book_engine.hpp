@@ -0,0 +1,182 @@
+#pragma once
+#include "lat_helper.hpp"
+#include "market_event.hpp"
+#include "order_book.hpp"
+#include "spsc.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <immintrin.h>
+
+// Event addressed to one book of a shard (book = shard-local book index)
+struct ShardEvent
+{
+	uint32_t book;
+	MarketEvent ev;
+};
+
+// Many OrderBooks split across shards, one pinned thread per shard. Each
+// shard owns its books and its own SPSC input ring, so shards share nothing
+// on the hot path. Symbols are registered up front; submit() routes by
+// symbol id through a flat table and is meant to be called from one feed
+// thread (the single producer of every shard ring).
+template <typename Book = OrderBook<>>
+class BookEngine
+{
+public:
+	struct SymbolConfig
+	{
+		Price bid_base;
+		Price ask_base;
+		Price tick_size;
+		size_t order_pool_capacity;
+	};
+
+private:
+	struct Route
+	{
+		uint32_t shard = UNROUTED;
+		uint32_t book = 0;
+	};
+
+	struct alignas(64) Shard
+	{
+		explicit Shard(size_t queue_size) : queue(queue_size) {}
+
+		spsc<ShardEvent> queue;
+		std::vector<SymbolConfig> configs;
+		std::vector<std::unique_ptr<Book>> books;
+		std::thread thread;
+		int core = 0;
+		std::atomic<bool> ready{false};
+	};
+
+	static constexpr uint32_t UNROUTED = ~uint32_t{0};
+
+	std::vector<std::unique_ptr<Shard>> shards_;
+	std::vector<Route> routes_; // indexed by symbol id
+	std::atomic<bool> running_{false};
+
+public:
+	// Shard i is pinned to core first_core + i (wrapping at the core count).
+	BookEngine(size_t shard_count, int first_core, size_t queue_size = 1 << 16)
+	{
+		if(shard_count == 0) throw std::invalid_argument("engine needs at least one shard");
+
+		shards_.reserve(shard_count);
+		for(size_t i=0; i<shard_count; i++)
+		{
+			shards_.push_back(std::make_unique<Shard>(queue_size));
+			shards_.back()->core = first_core + static_cast<int>(i);
+		}
+	}
+
+	~BookEngine() { stop(); }
+
+	BookEngine(const BookEngine&) = delete;
+	BookEngine& operator=(const BookEngine&) = delete;
+
+	// Registers a symbol before start(), placing it on the shard with the
+	// fewest books. Returns the shard index.
+	uint32_t add_symbol(uint32_t symbol_id, const SymbolConfig& config)
+	{
+		if(running_.load(std::memory_order_relaxed)) throw std::logic_error("add_symbol after start");
+		if(symbol_id >= routes_.size()) routes_.resize(symbol_id + 1);
+		if(routes_[symbol_id].shard != UNROUTED) throw std::invalid_argument("symbol already registered");
+
+		uint32_t target = 0;
+		for(uint32_t i=1; i<shards_.size(); i++)
+		{
+			if(shards_[i]->configs.size() < shards_[target]->configs.size()) target = i;
+		}
+
+		Shard& shard = *shards_[target];
+		routes_[symbol_id] = { target, static_cast<uint32_t>(shard.configs.size()) };
+		shard.configs.push_back(config);
+		return target;
+	}
+
+	// Spawns the shard threads. Each thread pins itself and then builds its
+	// books, so their memory is first touched from the owning core. Returns
+	// once every shard is ready to take events.
+	void start()
+	{
+		if(running_.exchange(true)) return;
+
+		for(auto& shard : shards_)
+		{
+			Shard* s = shard.get();
+			s->thread = std::thread([this, s]() { run_shard(*s); });
+		}
+
+		for(auto& shard : shards_)
+		{
+			while(!shard->ready.load(std::memory_order_acquire)) _mm_pause();
+		}
+	}
+
+	// Drains what is already queued and joins the shard threads.
+	void stop()
+	{
+		if(!running_.exchange(false)) return;
+
+		for(auto& shard : shards_)
+		{
+			if(shard->thread.joinable()) shard->thread.join();
+		}
+	}
+
+	// Feed-thread entry point. False if the symbol is unknown or its shard
+	// ring is full.
+	bool submit(uint32_t symbol_id, const MarketEvent& ev) noexcept
+	{
+		if(symbol_id >= routes_.size()) return false;
+
+		const Route route = routes_[symbol_id];
+		if(route.shard == UNROUTED) return false;
+
+		return shards_[route.shard]->queue.push(ShardEvent{ route.book, ev });
+	}
+
+	// Valid after start(). Mutating a book (e.g. adding listeners) is only
+	// safe before events for it are submitted.
+	Book& book(uint32_t symbol_id) noexcept
+	{
+		const Route route = routes_[symbol_id];
+		return *shards_[route.shard]->books[route.book];
+	}
+
+	size_t shard_count() const noexcept { return shards_.size(); }
+
+private:
+	void run_shard(Shard& shard)
+	{
+		pin_thread_to_core(shard.core);
+
+		shard.books.reserve(shard.configs.size());
+		for(const SymbolConfig& c : shard.configs)
+		{
+			shard.books.push_back(std::make_unique<Book>(c.bid_base, c.ask_base, c.tick_size, c.order_pool_capacity));
+		}
+		shard.ready.store(true, std::memory_order_release);
+
+		while(true)
+		{
+			if(const ShardEvent* se = shard.queue.front())
+			{
+				shard.books[se->book]->on_event(se->ev);
+				shard.queue.consume();
+			}
+			else
+			{
+				if(!running_.load(std::memory_order_acquire) && shard.queue.empty()) break;
+				_mm_pause();
+			}
+		}
+	}
+};
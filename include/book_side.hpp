@@ -1,201 +1,773 @@
 #pragma once
+#include <algorithm>
 #include <array>
-#include <iostream>
-#include <ostream>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <optional>
 
+#include "depth_kernels.hpp"
+#include "level_bitmap.hpp"
+#include "OrderPool.hpp"
 #include "types.hpp"
 
-template <Side S, std::size_t MaxLevels>
+// One side of the ladder. Levels are keyed by absolute tick (price / tick
+// size) and the hot window of MaxLevels ticks starting at base_tick_ lives in
+// a ring indexed by tick & MASK, so sliding the window only touches the levels
+// that enter or leave it. Levels outside the window are parked in overflow_
+// and pulled back into the ring when recenter() brings them into range.
+// Orders within a level are linked by pool index, resolved through the
+// OrderPool the side is built with; each order records its own tick, so
+// removing or resizing it needs no price.
+//
+// The ring is stored structure-of-arrays: quantities and order counts sit in
+// their own dense arrays, apart from the queue links, so depth scans and the
+// depth_kernels reductions stream over a tick range without touching the
+// links. Overflow levels stay whole PriceLevels.
+//
+// A non-zero TickSize fixes the tick at compile time, so price <-> tick
+// conversions compile to multiplies and shifts instead of divisions; the
+// constructor's tick_size is then ignored.
+template <Side S, std::size_t MaxLevels, Price TickSize = 0>
 class BookSide
 {
 private:
-	Price base_price_;
-	Price tick_size_;
-	int best_level_idx_;
+	static_assert((MaxLevels & (MaxLevels - 1)) == 0, "MaxLevels must be a power of two");
+
+	static constexpr uint32_t MASK = static_cast<uint32_t>(MaxLevels - 1);
+	static constexpr uint32_t NO_LEVEL = std::numeric_limits<uint32_t>::max();
+	static constexpr uint32_t MAX_BASE_TICK = NO_LEVEL - static_cast<uint32_t>(MaxLevels);
+
+	Price tick_size_; // read through tick_size(), which folds in TickSize
+	Price phase_; // price of tick 0, keeps the grid aligned to the constructor base
+	uint32_t base_tick_;
+	uint32_t best_tick_;
 	static constexpr Side side_ = S;
-	std::array<PriceLevel, MaxLevels> levels_{};
+
+	struct LevelLinks
+	{
+		uint32_t head = NULL_ORDER;
+		uint32_t tail = NULL_ORDER;
+	};
+
+	// one level's fields, wherever the level is stored
+	struct LevelRef
+	{
+		Qty& total_qty;
+		uint32_t& order_count;
+		uint32_t& head;
+		uint32_t& tail;
+	};
+
+	std::array<Qty, MaxLevels> qty_{};
+	std::array<uint32_t, MaxLevels> count_{};
+	std::array<LevelLinks, MaxLevels> links_{};
+	LevelBitmap<MaxLevels> occupied_;
+	std::map<uint32_t, PriceLevel> overflow_;
+	OrderPool& pool_;
+
+	// Near-touch sums, kept current on every quantity change relative to
+	// signal_best_ (the best as of the last rescan): qty within depth_ticks_
+	// of it, and qty within weight_ticks_ weighted linearly from weight_ticks_
+	// at the best down to 1. Levels better than signal_best_ are outside both
+	// until refresh_signals() rescans around the new best.
+	uint32_t depth_ticks_ = 10;
+	uint32_t weight_ticks_ = 5;
+	uint32_t signal_best_ = NO_LEVEL;
+	int64_t near_qty_ = 0;
+	int64_t weighted_qty_ = 0;
+	bool signals_changed_ = false;
 
 public:
-	explicit BookSide(Price base, Price tick_size)
-		: base_price_(base), tick_size_(tick_size), best_level_idx_(-1) {}
+	BookSide(Price base, Price tick_size, OrderPool& pool)
+		: tick_size_(TickSize != 0 ? TickSize : tick_size),
+		  phase_(base % tick_size_),
+		  base_tick_(std::min(base / tick_size_, MAX_BASE_TICK)),
+		  best_tick_(NO_LEVEL),
+		  pool_(pool) {}
 
-	void add_order(Order* order, Price price) noexcept
+	[[nodiscard]] Price tick_size() const noexcept
 	{
-		const int idx = price_to_index(price);
-		if(!is_valid_index(idx)) return;
+		if constexpr (TickSize != 0) return TickSize;
+		else return tick_size_;
+	}
 
-		PriceLevel& level = levels_[idx];
+	// false only for prices off the tick grid; out-of-window prices rest in overflow
+	bool add_order(Order* order, Price price) noexcept
+	{
+		const uint32_t tick = price_to_tick(price);
+		if(tick == NO_LEVEL) return false;
 
-		order->next = nullptr;
-		order->prev = level.tail;
+		LevelRef level = in_window(tick) ? ring_level(tick & MASK) : ref(overflow_[tick]);
 
-		if(level.tail)
-		{
-			level.tail->next = order;
-		}
-		else
-		{
-			level.head = order;
-		}
-		level.tail = order;
+		order->tick = tick;
+		append(level, order);
 
 		level.total_qty += order->quantity;
-		level.order_count++;
-		
-		update_best(idx);
+		if(level.order_count++ == 0 && in_window(tick)) occupied_.set(tick & MASK);
+
+		update_best(tick);
+		track(tick, order->quantity);
+		return true;
 	}
 
-	void remove_order(Order* order, Price price) noexcept
+	void remove_order(Order* order) noexcept
 	{
-		const int idx = price_to_index(price);
-		if(!is_valid_index(idx)) return;
+		const uint32_t tick = order->tick;
+		std::optional<LevelRef> level = find_level(tick);
+		if(!level) return;
 
-		PriceLevel& level = levels_[idx];
+		unlink(*level, order);
 
-		if(order->prev)
-		{
-			order->prev->next = order->next;
-		}
-		else
+		level->total_qty -= order->quantity;
+		level->order_count--;
+		track(tick, -static_cast<int64_t>(order->quantity));
+
+		if(level->order_count == 0)
 		{
-			level.head = order->next;
+			release_level(tick);
+			if(tick == best_tick_) best_tick_ = find_next_best_tick(tick);
 		}
+	}
 
-		if(order->next)
+	// Resizes a resting order. A reduce keeps its queue position; an increase
+	// sends it to the back of its level, as if it had just arrived.
+	void modify_order(Order* order, Qty new_qty) noexcept
+	{
+		std::optional<LevelRef> level = find_level(order->tick);
+		if(!level) return;
+
+		level->total_qty = level->total_qty - order->quantity + new_qty;
+		track(order->tick, static_cast<int64_t>(new_qty) - order->quantity);
+		const bool increase = new_qty > order->quantity;
+		order->quantity = new_qty;
+
+		if(increase && level->tail != order->index)
 		{
-			order->next->prev = order->prev;
+			unlink(*level, order);
+			append(*level, order);
 		}
-		else
+	}
+
+	// false for prices that cannot rest on this side's tick grid
+	[[nodiscard]] bool on_grid(Price price) const noexcept { return price_to_tick(price) != NO_LEVEL; }
+
+	// price of the level a resting order sits at
+	[[nodiscard]] Price price_of(const Order& order) const noexcept { return tick_to_price(order.tick); }
+
+	// Sweeps resting orders that cross `limit`, best level first and in queue
+	// order within a level, until `qty` is exhausted. on_fill(maker, fill_qty, price)
+	// is called per fill; a fully filled maker is already unlinked (quantity 0)
+	// so the callback may hand it back to the pool. Returns the unfilled qty.
+	template <typename OnFill>
+	Qty match(Price limit, Qty qty, OnFill&& on_fill) noexcept
+	{
+		while(qty > 0 && best_tick_ != NO_LEVEL)
 		{
-			level.tail = order->prev;
-		}
+			const Price best_price = tick_to_price(best_tick_);
+			if(!crosses(best_price, limit)) break;
+
+			LevelRef level = *find_level(best_tick_);
+			uint32_t maker_index = level.head;
 
-		level.total_qty -= order->quantity;
-        level.order_count--;
+			while(maker_index != NULL_ORDER && qty > 0)
+			{
+				Order* maker = pool_.at(maker_index);
+				const uint32_t next = maker->next;
+				const Qty fill = std::min(qty, maker->quantity);
+
+				qty -= fill;
+				maker->quantity -= fill;
+				level.total_qty -= fill;
+				track(best_tick_, -static_cast<int64_t>(fill));
 
-		if (level.order_count == 0 && idx == best_level_idx_) {
-            best_level_idx_ = find_next_best_index(idx);
-        }
+				if(maker->quantity == 0)
+				{
+					level.head = next;
+					if(next != NULL_ORDER) pool_.at(next)->prev = NULL_ORDER;
+					else level.tail = NULL_ORDER;
+					level.order_count--;
+				}
+
+				on_fill(maker, fill, best_price);
+				maker_index = next;
+			}
+
+			if(level.order_count == 0)
+			{
+				release_level(best_tick_);
+				best_tick_ = find_next_best_tick(best_tick_);
+			}
+		}
+		return qty;
 	}
 
-	void modify_order(Order* order, Price price, Qty new_qty) noexcept
+	// Slides the window so `center` sits in its middle. Levels leaving the
+	// window move to overflow_, overflow levels entering it move into the ring;
+	// the cost is proportional to the shift, not to MaxLevels.
+	void recenter(Price center) noexcept
 	{
-		const int idx = price_to_index(price);
-		if(!is_valid_index(idx)) return;
+		const uint32_t center_tick = nearest_tick(center);
+		const uint32_t half = static_cast<uint32_t>(MaxLevels / 2);
+		const uint32_t new_base = std::min(center_tick > half ? center_tick - half : 0u, MAX_BASE_TICK);
+		if(new_base == base_tick_) return;
+
+		const uint32_t old_base = base_tick_;
+		const uint32_t old_top = old_base + MASK;
+		const uint32_t new_top = new_base + MASK;
 
-		PriceLevel& level = levels_[idx];
+		// ticks of the old window that fall outside the new one
+		if(new_base > old_top || new_top < old_base) spill_range(old_base, old_top);
+		else if(new_base > old_base) spill_range(old_base, new_base - 1);
+		else spill_range(new_top + 1, old_top);
 
-		// TODO: here we can add move this order after tail if more quantity added (price-time priority)
-		level.total_qty = level.total_qty - order->quantity + new_qty;
-        order->quantity = new_qty
+		base_tick_ = new_base;
+
+		if(!overflow_.empty()) pull_range(new_base, new_top);
+	}
+
+	// true when `price` is within a quarter window of the window centre
+	[[nodiscard]] bool is_centered(Price price) const noexcept
+	{
+		const uint32_t tick = nearest_tick(price);
+		const uint32_t centre = base_tick_ + static_cast<uint32_t>(MaxLevels / 2);
+		const uint32_t drift = tick > centre ? tick - centre : centre - tick;
+		return drift < MaxLevels / 4;
+	}
+
+	// pulls the level line for `price` into cache ahead of an update
+	void prefetch(Price price) const noexcept
+	{
+		const uint32_t tick = price_to_tick(price);
+		if(!in_window(tick)) return;
+		__builtin_prefetch(&qty_[tick & MASK], 1);
+		__builtin_prefetch(&count_[tick & MASK], 1);
+		__builtin_prefetch(&links_[tick & MASK], 1);
 	}
 
 	[[nodiscard]] Price get_best_price() const noexcept
 	{
-		if (best_level_idx_ == -1) return INVALID_PRICE;
-        return base_price_ + (best_level_idx_ * tick_size_);
+		if (best_tick_ == NO_LEVEL) return INVALID_PRICE;
+		return tick_to_price(best_tick_);
 	}
 
 	[[nodiscard]] Qty get_best_qty() const noexcept
-    {
-        if (best_level_idx_ == -1) return 0;
-        return levels_[best_level_idx_].total_qty;
-    }
+	{
+		if (best_tick_ == NO_LEVEL) return 0;
+		return load_level(best_tick_).total_qty;
+	}
 
-	[[nodiscard]] const PriceLevel& get_level(Price price) const noexcept
+	// copy of the level at `price`, empty if nothing rests there
+	[[nodiscard]] PriceLevel get_level(Price price) const noexcept
 	{
-		const int idx = price_to_index(price);
-		static const PriceLevel empty_level{};
-		if(!is_valid_index(idx)) return empty_level;
-		return levels_[idx];
+		return load_level(price_to_tick(price));
 	}
 
+	[[nodiscard]] size_t overflow_levels() const noexcept { return overflow_.size(); }
+
 	void get_depth(DepthLevel* out, size_t max_levels, size_t& actual_count) const noexcept
 	{
 		actual_count = 0;
-		if(best_level_idx_ == -1) return;
-		
-		if constexpr(side_ == Side::BID)
+
+		for(uint32_t t=best_tick_; t != NO_LEVEL && actual_count < max_levels; t = find_next_best_tick(t))
 		{
-			for(int i=best_level_idx_; i>=0 && actual_count < max_levels; i--)
+			const PriceLevel level = load_level(t);
+			out[actual_count++] = {
+				.price = tick_to_price(t),
+				.qty = level.total_qty,
+				.order_count = level.order_count
+			};
+		}
+	}
+
+	// Calls f(order, price) for every resting order, best level first and in
+	// queue order within a level. Allocates nothing.
+	template <typename F>
+	void for_each_order(F&& f) const
+	{
+		for(uint32_t t=best_tick_; t != NO_LEVEL; t = find_next_best_tick(t))
+		{
+			const Price price = tick_to_price(t);
+			for(uint32_t i=load_level(t).head; i != NULL_ORDER;)
 			{
-				if(levels_[i].order_count > 0)
-				{
-					out[actual_count++] = {
-						.price = base_price_ + (i * tick_size_),
-						.qty = levels_[i].total_qty,
-						.order_count = levels_[i].order_count
-					};
-				}
+				const Order* order = pool_.at(i);
+				f(*order, price);
+				i = order->next;
 			}
 		}
-		else
+	}
+
+	// Total qty resting within `ticks` ticks of the best price, best included
+	[[nodiscard]] uint64_t depth_within(uint32_t ticks) const noexcept
+	{
+		if(best_tick_ == NO_LEVEL || ticks == 0) return 0;
+
+		uint64_t total = 0;
+		walk_runs(tick_away(ticks - 1), [&](const Qty* q, size_t n, uint32_t)
+		{
+			total += depth_kernels::sum(q, n);
+			return true;
+		});
+		return total;
+	}
+
+	// Sets the near-touch ranges (see the members) and rescans
+	void set_signal_window(uint32_t depth_ticks, uint32_t weight_ticks) noexcept
+	{
+		depth_ticks_ = depth_ticks;
+		weight_ticks_ = weight_ticks;
+		rescan_signals();
+	}
+
+	// Brings the near-touch sums up to date, rescanning only if the best has
+	// moved. Returns true if they changed since the previous call.
+	bool refresh_signals() noexcept
+	{
+		if(best_tick_ != signal_best_) rescan_signals();
+
+		const bool changed = signals_changed_;
+		signals_changed_ = false;
+		return changed;
+	}
+
+	// qty within depth_ticks of the best, as of the last refresh_signals()
+	[[nodiscard]] uint64_t near_depth() const noexcept { return static_cast<uint64_t>(near_qty_); }
+
+	// linearly weighted qty within weight_ticks of the best, likewise
+	[[nodiscard]] uint64_t weighted_depth() const noexcept { return static_cast<uint64_t>(weighted_qty_); }
+
+	// What taking `qty` off this side costs, walking out from the best price:
+	// how much fills, its notional (VWAP = notional / filled) and the price of
+	// the last level reached, i.e. the price needed to fill it.
+	[[nodiscard]] FillEstimate estimate_sweep(uint64_t qty) const noexcept
+	{
+		FillEstimate estimate{};
+		if(qty == 0 || best_tick_ == NO_LEVEL) return estimate;
+
+		walk_runs(tick_away(NO_LEVEL), [&](const Qty* q, size_t n, uint32_t first_tick)
 		{
-			for(int i=best_level_idx_; i<static_cast<int>(MaxLevels) && actual_count < max_levels; i++)
+			const uint64_t need = qty - estimate.filled;
+			depth_kernels::FillPoint fill;
+			size_t whole_begin = 0; // q[whole_begin, whole_end) is taken whole
+			size_t whole_end = n;
+
+			if constexpr (side_ == Side::BID)
 			{
-				if(levels_[i].order_count > 0)
-				{
-					out[actual_count++] = {
-						.price = base_price_ + (i * tick_size_),
-						.qty = levels_[i].total_qty,
-						.order_count = levels_[i].order_count
-					};
-				}
+				fill = depth_kernels::find_fill_reverse(q, n, need);
+				if(fill.index != n) whole_begin = fill.index + 1;
 			}
-		}
+			else
+			{
+				fill = depth_kernels::find_fill(q, n, need);
+				whole_end = fill.index;
+			}
+
+			estimate.filled += fill.before;
+			estimate.notional += fill.before * tick_to_price(first_tick + static_cast<uint32_t>(whole_begin))
+				+ static_cast<uint64_t>(tick_size()) * depth_kernels::index_weighted_sum(q + whole_begin, whole_end - whole_begin);
+
+			if(fill.index == n) return true;
 
+			const uint32_t tick = first_tick + static_cast<uint32_t>(fill.index);
+			estimate.filled += need - fill.before;
+			estimate.notional += (need - fill.before) * tick_to_price(tick);
+			estimate.worst_price = tick_to_price(tick);
+			return false;
+		});
+
+		if(estimate.filled < qty) estimate.worst_price = tick_to_price(worst_tick());
+		return estimate;
 	}
+
 private:
-	[[nodiscard]] bool is_valid_index(int idx) const noexcept
+	[[nodiscard]] bool in_window(uint32_t tick) const noexcept
 	{
-		return idx >= 0 && idx < static_cast<int>(MaxLevels);
+		return tick - base_tick_ < MaxLevels;
 	}
 
-	[[nodiscard]] int price_to_index(Price price) const noexcept
+	[[nodiscard]] uint32_t price_to_tick(Price price) const noexcept
 	{
-		if(price < base_price_) return -1;
+		if(price < phase_ || price == INVALID_PRICE) return NO_LEVEL;
+
+		const Price delta = price - phase_;
+
+		if(delta % tick_size() != 0) return NO_LEVEL;
 
-		const Price delta = price - base_price_;
+		return delta / tick_size();
+	}
 
-		if(delta % tick_size_ != 0) return -1;
+	// like price_to_tick but rounds off-grid prices down, for window placement
+	[[nodiscard]] uint32_t nearest_tick(Price price) const noexcept
+	{
+		return price < phase_ ? 0 : (price - phase_) / tick_size();
+	}
 
-		return static_cast<int>(delta / tick_size_);
+	[[nodiscard]] Price tick_to_price(uint32_t tick) const noexcept
+	{
+		return phase_ + tick * tick_size();
 	}
 
-	void update_best(int new_idx)
+	// true if a resting order on this side at `resting` trades against an
+	// incoming order limited at `limit`
+	[[nodiscard]] static constexpr bool crosses(Price resting, Price limit) noexcept
 	{
-		if(best_level_idx_ == -1)
+		if constexpr (side_ == Side::BID) return resting >= limit;
+		else return resting <= limit;
+	}
+
+	[[nodiscard]] static constexpr bool better(uint32_t a, uint32_t b) noexcept
+	{
+		if constexpr (side_ == Side::BID) return a > b;
+		else return a < b;
+	}
+
+	void track(uint32_t tick, int64_t delta) noexcept
+	{
+		if(signal_best_ == NO_LEVEL) return;
+
+		// ticks better than signal_best_ wrap to a huge distance
+		const uint32_t distance = side_ == Side::BID ? signal_best_ - tick : tick - signal_best_;
+
+		// the best level also feeds the microprice
+		if(distance == 0) signals_changed_ = true;
+
+		if(distance < depth_ticks_)
+		{
+			near_qty_ += delta;
+			signals_changed_ = true;
+		}
+		if(distance < weight_ticks_)
 		{
-			best_level_idx_ = new_idx;
-			return;
+			weighted_qty_ += (weight_ticks_ - distance) * delta;
+			signals_changed_ = true;
 		}
+	}
+
+	void rescan_signals() noexcept
+	{
+		signal_best_ = best_tick_;
+		signals_changed_ = true;
+		near_qty_ = static_cast<int64_t>(depth_within(depth_ticks_));
+		weighted_qty_ = 0;
+		if(best_tick_ == NO_LEVEL || weight_ticks_ == 0) return;
 
+		// sum((weight_ticks_ - distance) * q) = weight_ticks_ * sum(q) - sum(distance * q),
+		// with sum(distance * q) from sum(tick * q); unsigned wrap-around in
+		// the intermediates cancels out
+		uint64_t qty = 0;
+		uint64_t tick_weighted = 0;
+		walk_runs(tick_away(weight_ticks_ - 1), [&](const Qty* q, size_t n, uint32_t first_tick)
+		{
+			const uint64_t run = depth_kernels::sum(q, n);
+			qty += run;
+			tick_weighted += first_tick * run + depth_kernels::index_weighted_sum(q, n);
+			return true;
+		});
+
+		const uint64_t best_weighted = best_tick_ * qty;
+		const uint64_t distance_weighted = side_ == Side::BID ? best_weighted - tick_weighted : tick_weighted - best_weighted;
+		weighted_qty_ = static_cast<int64_t>(weight_ticks_ * qty - distance_weighted);
+	}
+
+	// tick `distance` ticks behind the best, clamped to the grid
+	[[nodiscard]] uint32_t tick_away(uint32_t distance) const noexcept
+	{
+		if constexpr (side_ == Side::BID) return best_tick_ > distance ? best_tick_ - distance : 0;
+		else return distance < NO_LEVEL - 1 - best_tick_ ? best_tick_ + distance : NO_LEVEL - 1;
+	}
+
+	// Visits the levels from the best tick out to `last` in priority order, as
+	// runs of quantities: f(q, n, first_tick) sees the levels at first_tick ..
+	// first_tick + n - 1 in q[0, n), empty ticks as zero. Window levels come
+	// straight from qty_, at most two runs per window; each overflow level is
+	// a run of one. Bid runs come highest first and are meant to be scanned
+	// from the back. f returns false to stop.
+	template <typename F>
+	void walk_runs(uint32_t last, F&& f) const noexcept
+	{
+		if(best_tick_ == NO_LEVEL) return;
+
+		const uint32_t top = base_tick_ + MASK;
+
+		if constexpr (side_ == Side::BID)
+		{
+			if(last > best_tick_) return;
+
+			// parked above the window
+			auto it = overflow_.upper_bound(best_tick_);
+			while(it != overflow_.begin())
+			{
+				--it;
+				if(it->first <= top || it->first < last) break;
+				if(!f(&it->second.total_qty, 1, it->first)) return;
+			}
+
+			const uint32_t lo = std::max(last, base_tick_);
+			const uint32_t hi = std::min(best_tick_, top);
+			if(lo <= hi)
+			{
+				const uint32_t slot = lo & MASK;
+				const uint32_t n = hi - lo + 1;
+				const uint32_t first = std::min(n, static_cast<uint32_t>(MaxLevels) - slot);
+
+				if(first < n && !f(&qty_[0], n - first, lo + first)) return;
+				if(!f(&qty_[slot], first, lo)) return;
+			}
+
+			if(last >= base_tick_) return;
+
+			// parked below the window
+			it = overflow_.lower_bound(base_tick_);
+			while(it != overflow_.begin())
+			{
+				--it;
+				if(it->first < last) break;
+				if(!f(&it->second.total_qty, 1, it->first)) return;
+			}
+		}
+		else
+		{
+			if(last < best_tick_) return;
+
+			// parked below the window
+			auto it = overflow_.begin();
+			for(; it != overflow_.end() && it->first < base_tick_ && it->first <= last; ++it)
+			{
+				if(!f(&it->second.total_qty, 1, it->first)) return;
+			}
+
+			const uint32_t lo = std::max(best_tick_, base_tick_);
+			const uint32_t hi = std::min(last, top);
+			if(lo <= hi)
+			{
+				const uint32_t slot = lo & MASK;
+				const uint32_t n = hi - lo + 1;
+				const uint32_t first = std::min(n, static_cast<uint32_t>(MaxLevels) - slot);
+
+				if(!f(&qty_[slot], first, lo)) return;
+				if(first < n && !f(&qty_[0], n - first, lo + first)) return;
+			}
+
+			if(last <= top) return;
+
+			// parked above the window
+			for(it = overflow_.upper_bound(top); it != overflow_.end() && it->first <= last; ++it)
+			{
+				if(!f(&it->second.total_qty, 1, it->first)) return;
+			}
+		}
+	}
+
+	// the occupied level furthest from the best
+	[[nodiscard]] uint32_t worst_tick() const noexcept
+	{
 		if constexpr (side_ == Side::BID)
 		{
-			if(new_idx > best_level_idx_) best_level_idx_ = new_idx;
+			if(!overflow_.empty() && overflow_.begin()->first < base_tick_) return overflow_.begin()->first;
+
+			const uint32_t in_ring = window_next(base_tick_);
+			if(in_ring != NO_LEVEL || overflow_.empty()) return in_ring;
+			return overflow_.begin()->first;
+		}
+		else
+		{
+			if(!overflow_.empty() && overflow_.rbegin()->first > base_tick_ + MASK) return overflow_.rbegin()->first;
+
+			const uint32_t in_ring = window_prev(base_tick_ + MASK);
+			if(in_ring != NO_LEVEL || overflow_.empty()) return in_ring;
+			return overflow_.rbegin()->first;
+		}
+	}
+
+	LevelRef ring_level(uint32_t slot) noexcept
+	{
+		return { qty_[slot], count_[slot], links_[slot].head, links_[slot].tail };
+	}
+
+	static LevelRef ref(PriceLevel& level) noexcept
+	{
+		return { level.total_qty, level.order_count, level.head, level.tail };
+	}
+
+	std::optional<LevelRef> find_level(uint32_t tick) noexcept
+	{
+		if(in_window(tick)) return ring_level(tick & MASK);
+		if(tick == NO_LEVEL || overflow_.empty()) return std::nullopt;
+
+		auto it = overflow_.find(tick);
+		if(it == overflow_.end()) return std::nullopt;
+		return ref(it->second);
+	}
+
+	PriceLevel load_level(uint32_t tick) const noexcept
+	{
+		if(in_window(tick))
+		{
+			const uint32_t slot = tick & MASK;
+			return { qty_[slot], count_[slot], links_[slot].head, links_[slot].tail };
+		}
+		if(tick == NO_LEVEL || overflow_.empty()) return {};
+
+		auto it = overflow_.find(tick);
+		return it == overflow_.end() ? PriceLevel{} : it->second;
+	}
+
+	void append(LevelRef level, Order* order) noexcept
+	{
+		order->next = NULL_ORDER;
+		order->prev = level.tail;
+
+		if(level.tail != NULL_ORDER)
+		{
+			pool_.at(level.tail)->next = order->index;
+		}
+		else
+		{
+			level.head = order->index;
+		}
+		level.tail = order->index;
+	}
+
+	void unlink(LevelRef level, Order* order) noexcept
+	{
+		if(order->prev != NULL_ORDER)
+		{
+			pool_.at(order->prev)->next = order->next;
+		}
+		else
+		{
+			level.head = order->next;
+		}
+
+		if(order->next != NULL_ORDER)
+		{
+			pool_.at(order->next)->prev = order->prev;
 		}
 		else
 		{
-			if(new_idx < best_level_idx_) best_level_idx_ = new_idx;
+			level.tail = order->prev;
 		}
 	}
 
-	int find_next_best_index(int idx) 
+	// drops an emptied level from the occupancy bitmap or the overflow map
+	void release_level(uint32_t tick) noexcept
+	{
+		if(in_window(tick)) occupied_.clear(tick & MASK);
+		else overflow_.erase(tick);
+	}
+
+	void update_best(uint32_t tick) noexcept
+	{
+		if(best_tick_ == NO_LEVEL || better(tick, best_tick_)) best_tick_ = tick;
+	}
+
+	// next occupied level behind `tick` in priority order, window or overflow
+	uint32_t find_next_best_tick(uint32_t tick) const noexcept
 	{
-		if constexpr (side_ == Side.BID)
+		const uint32_t top = base_tick_ + MASK;
+		uint32_t in_ring = NO_LEVEL;
+		uint32_t parked = NO_LEVEL;
+
+		if constexpr (side_ == Side::BID)
 		{
-			for(int i=idx-1; i>=0; i--)
+			if(tick > base_tick_) in_ring = window_prev(std::min(tick - 1, top));
+
+			if(!overflow_.empty())
 			{
-				if(levels_[i].order_count > 0) return i;
+				auto it = overflow_.lower_bound(tick);
+				if(it != overflow_.begin()) parked = std::prev(it)->first;
 			}
 		}
 		else
 		{
-			for(int i=idx+1; i<static_cast<int>(MaxLevels); i++)
+			if(tick < top) in_ring = window_next(std::max(tick + 1, base_tick_));
+
+			if(!overflow_.empty())
+			{
+				auto it = overflow_.upper_bound(tick);
+				if(it != overflow_.end()) parked = it->first;
+			}
+		}
+
+		if(in_ring == NO_LEVEL) return parked;
+		if(parked == NO_LEVEL) return in_ring;
+		return better(in_ring, parked) ? in_ring : parked;
+	}
+
+	// lowest occupied window tick >= lo (lo must be inside the window)
+	uint32_t window_next(uint32_t lo) const noexcept
+	{
+		const size_t slot = lo & MASK;
+		const size_t span = base_tick_ + MASK - lo; // window ticks above lo
+
+		int r = occupied_.find_next(slot);
+		if(r != -1 && static_cast<size_t>(r) - slot <= span)
+		{
+			return lo + static_cast<uint32_t>(static_cast<size_t>(r) - slot);
+		}
+
+		if(slot + span >= MaxLevels)
+		{
+			r = occupied_.find_next(0);
+			if(r != -1 && static_cast<size_t>(r) <= slot + span - MaxLevels)
+			{
+				return lo + static_cast<uint32_t>(MaxLevels - slot + static_cast<size_t>(r));
+			}
+		}
+		return NO_LEVEL;
+	}
+
+	// highest occupied window tick <= hi (hi must be inside the window)
+	uint32_t window_prev(uint32_t hi) const noexcept
+	{
+		const size_t slot = hi & MASK;
+		const size_t span = hi - base_tick_; // window ticks below hi
+
+		int r = occupied_.find_prev(slot);
+		if(r != -1 && slot - static_cast<size_t>(r) <= span)
+		{
+			return hi - static_cast<uint32_t>(slot - static_cast<size_t>(r));
+		}
+
+		if(span > slot)
+		{
+			r = occupied_.find_prev(MaxLevels - 1);
+			if(r != -1 && static_cast<size_t>(r) >= slot + MaxLevels - span)
 			{
-				if(levels_[i].order_count > 0) return i;
+				return hi - static_cast<uint32_t>(slot + MaxLevels - static_cast<size_t>(r));
 			}
 		}
-		return -1;
+		return NO_LEVEL;
+	}
+
+	// moves occupied ring levels for ticks [lo, hi] of the current window into overflow_
+	void spill_range(uint32_t lo, uint32_t hi) noexcept
+	{
+		for(uint32_t t=window_next(lo); t != NO_LEVEL && t <= hi; t = t < hi ? window_next(t + 1) : NO_LEVEL)
+		{
+			const uint32_t slot = t & MASK;
+			overflow_.emplace(t, load_level(t));
+			qty_[slot] = 0;
+			count_[slot] = 0;
+			links_[slot] = LevelLinks{};
+			occupied_.clear(slot);
+		}
+	}
+
+	// moves overflow levels for ticks [lo, hi] (the current window) into the ring
+	void pull_range(uint32_t lo, uint32_t hi) noexcept
+	{
+		auto it = overflow_.lower_bound(lo);
+		while(it != overflow_.end() && it->first <= hi)
+		{
+			const uint32_t slot = it->first & MASK;
+			qty_[slot] = it->second.total_qty;
+			count_[slot] = it->second.order_count;
+			links_[slot] = { it->second.head, it->second.tail };
+			occupied_.set(slot);
+			it = overflow_.erase(it);
+		}
 	}
 };
@@ -0,0 +1,413 @@
+#pragma once
+#include "capture_file.hpp"
+#include "market_event.hpp"
+#include "types.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Recovery state for one book, kept in a directory:
+//
+//   snapshot          every resting order as of journal seq `last_seq`: bids
+//                     then asks, best level first, queue order within a level
+//   journal.<seq>     append-only segments of sequenced MarketEvents, named
+//                     after the first seq they hold
+//
+// The order index and the ladder bases are not stored: re-adding the snapshot
+// orders in sequence rebuilds the levels, queue priority and index, and the
+// ladder recenters on the first order of each side as it does live.
+
+struct SnapshotHeader
+{
+	static constexpr char MAGIC[8] = { 'O', 'B', 'S', 'N', 'A', 'P', '0', '1' };
+	static constexpr uint32_t VERSION = 1;
+
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	uint64_t last_seq;
+	uint64_t order_count;
+	Price tick_size;
+	uint32_t reserved;
+};
+
+struct SnapshotOrder
+{
+	uint64_t order_id;
+	Price price;
+	Qty qty;
+	Side side;
+	uint8_t reserved[7];
+};
+
+struct JournalHeader
+{
+	static constexpr char MAGIC[8] = { 'O', 'B', 'J', 'R', 'N', 'L', '0', '1' };
+	static constexpr uint32_t VERSION = 1;
+
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	uint64_t first_seq;
+};
+
+struct JournalRecord
+{
+	uint64_t seq;
+	MarketEvent ev;
+};
+
+static_assert(sizeof(SnapshotHeader) == 40);
+static_assert(sizeof(SnapshotOrder) == 24);
+static_assert(sizeof(JournalHeader) % alignof(JournalRecord) == 0);
+static_assert(sizeof(JournalRecord) == 40);
+
+// Owned by the book thread. record() every event before it is applied, call
+// flush() when the input goes idle, snapshot() every so often and poll() until
+// it reports the snapshot done.
+//
+// Match says how the live path applies the recorded events, on_event (true)
+// or on_feed_event (false); recovery replays the journal the same way, so a
+// feed-driven book does not trade against itself on restart.
+//
+// snapshot() forks: the child holds a copy-on-write image of the book and
+// writes it out while the parent carries on, so the book thread only pays for
+// the fork itself. The child runs in a copy of a multithreaded process and
+// therefore sticks to raw syscalls and stack buffers.
+template <typename Book, bool Match = true>
+class BookStore
+{
+private:
+	static constexpr size_t JOURNAL_BUFFER = 4096; // records per write()
+	static constexpr size_t SNAPSHOT_CHUNK = 2048; // records per write() in the child
+
+	std::filesystem::path dir_;
+	std::string snapshot_path_;
+	std::string snapshot_tmp_;
+
+	int journal_fd_ = -1;
+	uint64_t seq_ = 0; // last event recorded
+	std::unique_ptr<JournalRecord[]> buffer_;
+	size_t buffered_ = 0;
+
+	pid_t writer_ = -1;
+	uint64_t writer_seq_ = 0; // last_seq of the snapshot being written
+	uint64_t snapshots_ = 0;
+	uint64_t failed_snapshots_ = 0;
+
+	std::string segment_path(uint64_t first_seq) const
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "journal.%020" PRIu64, first_seq);
+		return (dir_ / name).string();
+	}
+
+	// (first seq, path) of every journal segment, oldest first
+	std::vector<std::pair<uint64_t, std::string>> segments() const
+	{
+		std::vector<std::pair<uint64_t, std::string>> out;
+		for(const auto& entry : std::filesystem::directory_iterator(dir_))
+		{
+			const std::string name = entry.path().filename().string();
+			if(name.rfind("journal.", 0) != 0) continue;
+			out.emplace_back(std::strtoull(name.c_str() + 8, nullptr, 10), entry.path().string());
+		}
+		std::sort(out.begin(), out.end());
+		return out;
+	}
+
+	static void write_all(int fd, const void* data, size_t size, const std::string& path)
+	{
+		const char* p = static_cast<const char*>(data);
+		while(size > 0)
+		{
+			const ssize_t n = ::write(fd, p, size);
+			if(n < 0)
+			{
+				if(errno == EINTR) continue;
+				throw std::system_error(errno, std::generic_category(), path);
+			}
+			p += n;
+			size -= static_cast<size_t>(n);
+		}
+	}
+
+	// child side: same as write_all, but reports failure instead of throwing
+	static bool write_raw(int fd, const void* data, size_t size) noexcept
+	{
+		const char* p = static_cast<const char*>(data);
+		while(size > 0)
+		{
+			const ssize_t n = ::write(fd, p, size);
+			if(n < 0)
+			{
+				if(errno == EINTR) continue;
+				return false;
+			}
+			p += n;
+			size -= static_cast<size_t>(n);
+		}
+		return true;
+	}
+
+	void open_segment()
+	{
+		const std::string path = segment_path(seq_ + 1);
+		journal_fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if(journal_fd_ < 0) throw std::system_error(errno, std::generic_category(), path);
+
+		JournalHeader h{};
+		std::memcpy(h.magic, JournalHeader::MAGIC, sizeof(h.magic));
+		h.version = JournalHeader::VERSION;
+		h.record_size = sizeof(JournalRecord);
+		h.first_seq = seq_ + 1;
+		write_all(journal_fd_, &h, sizeof(h), path);
+	}
+
+	void close_segment() noexcept
+	{
+		if(journal_fd_ < 0) return;
+		::close(journal_fd_);
+		journal_fd_ = -1;
+	}
+
+	uint64_t load_snapshot(Book& book) const
+	{
+		MappedFile file(snapshot_path_, true);
+		if(file.size() < sizeof(SnapshotHeader) || std::memcmp(file.data(), SnapshotHeader::MAGIC, sizeof(SnapshotHeader::MAGIC)) != 0)
+		{
+			throw std::runtime_error(snapshot_path_ + ": not a book snapshot");
+		}
+
+		SnapshotHeader h;
+		std::memcpy(&h, file.data(), sizeof(h));
+		if(h.version != SnapshotHeader::VERSION || h.record_size != sizeof(SnapshotOrder))
+		{
+			throw std::runtime_error(snapshot_path_ + ": written by an incompatible build");
+		}
+		if(h.tick_size != book.tick_size()) throw std::runtime_error(snapshot_path_ + ": tick size does not match the book");
+		if(file.size() < sizeof(h) + h.order_count * sizeof(SnapshotOrder)) throw std::runtime_error(snapshot_path_ + ": truncated");
+
+		const auto* orders = reinterpret_cast<const SnapshotOrder*>(file.data() + sizeof(h));
+		for(uint64_t i=0; i<h.order_count; i++)
+		{
+			// only rest: a feed-driven book can be saved locked or crossed
+			book.rest_order(orders[i].order_id, orders[i].price, orders[i].qty, orders[i].side);
+		}
+		return h.last_seq;
+	}
+
+	// Replays the records after seq_ in one segment. False once the sequence
+	// breaks (a torn or missing write, or a zeroed hole), after which nothing
+	// later is trusted. The segment is then cut at the break: left whole, the
+	// next recovery would stop at the same point and discard every segment
+	// journalled after this one.
+	bool replay_segment(Book& book, const std::string& path)
+	{
+		size_t valid_size = 0;
+		{
+			MappedFile file(path, true);
+			// a crash can leave a new segment before its header is written
+			if(file.size() < sizeof(JournalHeader)) return true;
+			if(std::memcmp(file.data(), JournalHeader::MAGIC, sizeof(JournalHeader::MAGIC)) != 0)
+			{
+				throw std::runtime_error(path + ": not a journal segment");
+			}
+
+			JournalHeader h;
+			std::memcpy(&h, file.data(), sizeof(h));
+			if(h.version != JournalHeader::VERSION || h.record_size != sizeof(JournalRecord))
+			{
+				throw std::runtime_error(path + ": written by an incompatible build");
+			}
+
+			// a partial record at the tail is a write cut short by the crash
+			const size_t count = (file.size() - sizeof(h)) / sizeof(JournalRecord);
+			const auto* records = reinterpret_cast<const JournalRecord*>(file.data() + sizeof(h));
+			for(size_t i=0; i<count; i++)
+			{
+				// records are contiguous, so a slot's seq follows from its position;
+				// whatever lies in a slot the snapshot covers is never read
+				const uint64_t slot_seq = h.first_seq + i;
+				if(slot_seq <= seq_) continue;
+				if(slot_seq != seq_ + 1 || records[i].seq != slot_seq)
+				{
+					valid_size = sizeof(h) + i * sizeof(JournalRecord);
+					break;
+				}
+				if constexpr (Match) book.on_event(records[i].ev);
+				else book.on_feed_event(records[i].ev);
+				seq_ = slot_seq;
+			}
+			if(valid_size == 0) return true;
+		}
+
+		if(::truncate(path.c_str(), static_cast<off_t>(valid_size)) != 0)
+		{
+			throw std::system_error(errno, std::generic_category(), path);
+		}
+		return false;
+	}
+
+	[[noreturn]] void write_snapshot_child(const Book& book) const noexcept
+	{
+		const int fd = ::open(snapshot_tmp_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(fd < 0) ::_exit(1);
+
+		SnapshotHeader h{};
+		std::memcpy(h.magic, SnapshotHeader::MAGIC, sizeof(h.magic));
+		h.version = SnapshotHeader::VERSION;
+		h.record_size = sizeof(SnapshotOrder);
+		h.last_seq = writer_seq_;
+		h.tick_size = book.tick_size();
+		bool ok = write_raw(fd, &h, sizeof(h));
+
+		SnapshotOrder chunk[SNAPSHOT_CHUNK];
+		size_t n = 0;
+		book.for_each_order([&](const Order& order, Price price)
+		{
+			if(!ok) return;
+			chunk[n] = SnapshotOrder{ .order_id = order.order_id, .price = price, .qty = order.quantity, .side = order.side, .reserved = {} };
+			h.order_count++;
+			if(++n == SNAPSHOT_CHUNK)
+			{
+				ok = write_raw(fd, chunk, sizeof(chunk));
+				n = 0;
+			}
+		});
+
+		ok = ok && write_raw(fd, chunk, n * sizeof(SnapshotOrder));
+		ok = ok && ::pwrite(fd, &h, sizeof(h), 0) == static_cast<ssize_t>(sizeof(h));
+		ok = ok && ::fsync(fd) == 0;
+		::close(fd);
+		ok = ok && ::rename(snapshot_tmp_.c_str(), snapshot_path_.c_str()) == 0;
+		::_exit(ok ? 0 : 1);
+	}
+
+public:
+	explicit BookStore(std::filesystem::path dir)
+		: dir_(std::move(dir))
+		, snapshot_path_((dir_ / "snapshot").string())
+		, snapshot_tmp_((dir_ / "snapshot.tmp").string())
+		, buffer_(std::make_unique<JournalRecord[]>(JOURNAL_BUFFER))
+	{
+		std::filesystem::create_directories(dir_);
+	}
+
+	~BookStore()
+	{
+		try { flush(); } catch(...) {}
+		close_segment();
+		if(writer_ > 0)
+		{
+			int status = 0;
+			::waitpid(writer_, &status, 0);
+		}
+	}
+
+	BookStore(const BookStore&) = delete;
+	BookStore& operator=(const BookStore&) = delete;
+
+	// Loads the snapshot (if any) into an empty book, replays the journal tail
+	// and opens a fresh segment. Must run once, before record(). Returns the
+	// last seq applied; 0 for an empty directory.
+	uint64_t recover(Book& book)
+	{
+		seq_ = 0;
+		if(std::filesystem::exists(snapshot_path_)) seq_ = load_snapshot(book);
+
+		for(const auto& [first_seq, path] : segments())
+		{
+			if(!replay_segment(book, path)) break;
+		}
+
+		// whatever lies past a break was never applied and must not be
+		// replayed behind the records journalled from here on
+		for(const auto& [first_seq, path] : segments())
+		{
+			if(first_seq > seq_) std::filesystem::remove(path);
+		}
+
+		open_segment();
+		return seq_;
+	}
+
+	void record(const MarketEvent& ev)
+	{
+		buffer_[buffered_++] = JournalRecord{ .seq = ++seq_, .ev = ev };
+		if(buffered_ == JOURNAL_BUFFER) flush();
+	}
+
+	// Hands buffered records to the kernel. A process crash loses nothing
+	// flushed; surviving a machine crash would take an fdatasync as well.
+	void flush()
+	{
+		if(buffered_ == 0) return;
+		write_all(journal_fd_, buffer_.get(), buffered_ * sizeof(JournalRecord), segment_path(seq_ + 1 - buffered_));
+		buffered_ = 0;
+	}
+
+	// Starts writing a snapshot of `book`, which must reflect every recorded
+	// event. False if the previous one is still being written.
+	bool snapshot(const Book& book)
+	{
+		if(writer_ > 0) return false;
+
+		// a new segment keeps every older one wholly covered by this snapshot
+		flush();
+		close_segment();
+		open_segment();
+
+		writer_seq_ = seq_;
+		const pid_t pid = ::fork();
+		if(pid < 0) throw std::system_error(errno, std::generic_category(), "fork");
+		if(pid == 0) write_snapshot_child(book);
+
+		writer_ = pid;
+		return true;
+	}
+
+	// Reaps a finished snapshot writer; true when a snapshot has just been
+	// committed, in which case the journal segments it covers are removed.
+	bool poll()
+	{
+		if(writer_ <= 0) return false;
+
+		int status = 0;
+		if(::waitpid(writer_, &status, WNOHANG) == 0) return false;
+		writer_ = -1;
+
+		if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		{
+			failed_snapshots_++;
+			return false;
+		}
+
+		for(const auto& [first_seq, path] : segments())
+		{
+			if(first_seq <= writer_seq_) std::filesystem::remove(path);
+		}
+		snapshots_++;
+		return true;
+	}
+
+	bool snapshot_running() const noexcept { return writer_ > 0; }
+	uint64_t seq() const noexcept { return seq_; }
+	uint64_t snapshots() const noexcept { return snapshots_; }
+	uint64_t failed_snapshots() const noexcept { return failed_snapshots_; }
+};
@@ -0,0 +1,28 @@
+#pragma once
+#include "order_index.hpp"
+#include "orderbook_listener.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+
+// Compile-time shape of an OrderBook. Instrument classes derive from
+// DefaultBookTraits and override what they need, e.g. a narrow ladder that
+// keeps the whole book in L2:
+//
+//     struct FutureTraits : DefaultBookTraits
+//     {
+//         static constexpr size_t LADDER_LEVELS = 4096;
+//         static constexpr Price TICK_SIZE = 25;
+//     };
+//
+// A side's ring costs 16 bytes per ladder level (qty, count, head, tail), so
+// the default 1 << 17 levels is 2MB a side.
+struct DefaultBookTraits
+{
+	using Index = HashOrderIndex;       // order-id lookup, see order_index.hpp
+	using Listeners = DynamicListeners; // listener dispatch, see orderbook_listener.hpp
+
+	static constexpr size_t LADDER_LEVELS = MAX_PRICE_LEVELS; // ring ticks per side, a power of two
+	static constexpr size_t DEPTH_LEVELS = 10; // levels per side in the seqlock depth snapshot
+	static constexpr Price TICK_SIZE = 0;      // non-zero fixes the tick, overriding the constructor's
+};
@@ -0,0 +1,187 @@
+#pragma once
+#include "market_event.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only mapping of a whole capture file, hinted for a front-to-back scan.
+class MappedFile
+{
+private:
+	const uint8_t* data_ = nullptr;
+	size_t size_ = 0;
+
+public:
+	explicit MappedFile(const std::string& path, bool populate = false)
+	{
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if(fd < 0) throw std::system_error(errno, std::generic_category(), path);
+
+		struct stat st{};
+		if(::fstat(fd, &st) != 0)
+		{
+			const int err = errno;
+			::close(fd);
+			throw std::system_error(err, std::generic_category(), path);
+		}
+
+		size_ = static_cast<size_t>(st.st_size);
+		if(size_ > 0)
+		{
+			void* mem = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), fd, 0);
+			if(mem == MAP_FAILED)
+			{
+				const int err = errno;
+				::close(fd);
+				throw std::system_error(err, std::generic_category(), path);
+			}
+			::madvise(mem, size_, MADV_SEQUENTIAL | MADV_WILLNEED);
+			data_ = static_cast<const uint8_t*>(mem);
+		}
+		::close(fd);
+	}
+
+	~MappedFile()
+	{
+		if(data_) ::munmap(const_cast<uint8_t*>(data_), size_);
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const uint8_t* data() const noexcept { return data_; }
+	size_t size() const noexcept { return size_; }
+};
+
+// Compact internal capture: a header, `count` MarketEvents laid out exactly as
+// in memory, then `count` receive timestamps. The event array can be handed
+// to OrderBook::on_events straight from the mapping.
+struct CaptureHeader
+{
+	static constexpr char MAGIC[8] = { 'O', 'B', 'C', 'A', 'P', 'T', 'R', '1' };
+	static constexpr uint32_t VERSION = 3;
+
+	char magic[8];
+	uint32_t version;
+	uint32_t event_size;
+	uint64_t count;
+};
+
+static_assert(sizeof(CaptureHeader) % alignof(MarketEvent) == 0);
+static_assert(sizeof(MarketEvent) % alignof(uint64_t) == 0);
+
+class CaptureView
+{
+private:
+	std::span<const MarketEvent> events_;
+	std::span<const uint64_t> timestamps_;
+
+public:
+	static bool matches(const uint8_t* data, size_t size) noexcept
+	{
+		return size >= sizeof(CaptureHeader) && std::memcmp(data, CaptureHeader::MAGIC, sizeof(CaptureHeader::MAGIC)) == 0;
+	}
+
+	CaptureView(const uint8_t* data, size_t size)
+	{
+		if(!matches(data, size)) throw std::runtime_error("not an internal capture file");
+
+		CaptureHeader h;
+		std::memcpy(&h, data, sizeof(h));
+		if(h.version != CaptureHeader::VERSION || h.event_size != sizeof(MarketEvent))
+		{
+			throw std::runtime_error("capture file was written by an incompatible build");
+		}
+
+		const size_t need = sizeof(CaptureHeader) + h.count * (sizeof(MarketEvent) + sizeof(uint64_t));
+		if(size < need) throw std::runtime_error("capture file is truncated");
+
+		const uint8_t* events = data + sizeof(CaptureHeader);
+		const uint8_t* stamps = events + h.count * sizeof(MarketEvent);
+		events_ = { reinterpret_cast<const MarketEvent*>(events), h.count };
+		timestamps_ = { reinterpret_cast<const uint64_t*>(stamps), h.count };
+	}
+
+	std::span<const MarketEvent> events() const noexcept { return events_; }
+	std::span<const uint64_t> timestamps() const noexcept { return timestamps_; }
+};
+
+// Writes the internal format. Timestamps go to a scratch file while events
+// stream out, and are appended behind the events on close().
+class CaptureWriter
+{
+private:
+	std::FILE* out_ = nullptr;
+	std::FILE* stamps_ = nullptr;
+	uint64_t count_ = 0;
+
+public:
+	explicit CaptureWriter(const std::string& path)
+	{
+		out_ = std::fopen(path.c_str(), "wb");
+		if(!out_) throw std::system_error(errno, std::generic_category(), path);
+
+		stamps_ = std::tmpfile();
+		if(!stamps_)
+		{
+			const int err = errno;
+			std::fclose(out_);
+			throw std::system_error(err, std::generic_category(), "tmpfile");
+		}
+
+		const CaptureHeader placeholder{};
+		std::fwrite(&placeholder, sizeof(placeholder), 1, out_);
+	}
+
+	~CaptureWriter()
+	{
+		if(!out_) return;
+		try { close(); } catch(...) {}
+	}
+
+	CaptureWriter(const CaptureWriter&) = delete;
+	CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+	void write(const MarketEvent& ev, uint64_t timestamp_ns)
+	{
+		std::fwrite(&ev, sizeof(ev), 1, out_);
+		std::fwrite(&timestamp_ns, sizeof(timestamp_ns), 1, stamps_);
+		count_++;
+	}
+
+	uint64_t count() const noexcept { return count_; }
+
+	void close()
+	{
+		std::rewind(stamps_);
+		char buf[1 << 16];
+		size_t n;
+		while((n = std::fread(buf, 1, sizeof(buf), stamps_)) > 0) std::fwrite(buf, 1, n, out_);
+		std::fclose(stamps_);
+		stamps_ = nullptr;
+
+		CaptureHeader h{};
+		std::memcpy(h.magic, CaptureHeader::MAGIC, sizeof(h.magic));
+		h.version = CaptureHeader::VERSION;
+		h.event_size = sizeof(MarketEvent);
+		h.count = count_;
+		std::fseek(out_, 0, SEEK_SET);
+		std::fwrite(&h, sizeof(h), 1, out_);
+
+		const bool failed = std::ferror(out_) != 0;
+		std::fclose(out_);
+		out_ = nullptr;
+		if(failed) throw std::runtime_error("failed writing capture file");
+	}
+};
@@ -0,0 +1,223 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "types.hpp"
+
+// Reductions over a dense run of level quantities, as BookSide keeps them in
+// its ring (one Qty per tick, zero for empty ticks). Sums are widened to 64
+// bits. The ISA is picked at compile time from the target flags (the build
+// uses -march=native); scalar:: holds the reference versions, which are also
+// the fallback.
+namespace depth_kernels
+{
+
+// Where a running total first reaches a target: `index` is the level that
+// completes it (n if the run falls short) and `before` is the qty taken from
+// the levels ahead of it in scan order.
+struct FillPoint
+{
+	size_t index;
+	uint64_t before;
+};
+
+namespace scalar
+{
+
+inline uint64_t sum(const Qty* q, size_t n) noexcept
+{
+	uint64_t total = 0;
+	for(size_t i=0; i<n; i++) total += q[i];
+	return total;
+}
+
+// sum of i * q[i], which turns a run's quantities into its notional given the
+// price of q[0] and the tick size
+inline uint64_t index_weighted_sum(const Qty* q, size_t n) noexcept
+{
+	uint64_t total = 0;
+	for(size_t i=0; i<n; i++) total += i * q[i];
+	return total;
+}
+
+// scans q[0], q[1], ...
+inline FillPoint find_fill(const Qty* q, size_t n, uint64_t target) noexcept
+{
+	uint64_t before = 0;
+	for(size_t i=0; i<n; i++)
+	{
+		if(before + q[i] >= target) return { i, before };
+		before += q[i];
+	}
+	return { n, before };
+}
+
+// scans q[n - 1], q[n - 2], ...
+inline FillPoint find_fill_reverse(const Qty* q, size_t n, uint64_t target) noexcept
+{
+	uint64_t before = 0;
+	for(size_t i=n; i-- > 0;)
+	{
+		if(before + q[i] >= target) return { i, before };
+		before += q[i];
+	}
+	return { n, before };
+}
+
+} // namespace scalar
+
+#if defined(__AVX512F__)
+
+// GCC 12 flags the undefined passthrough operands inside many AVX-512
+// intrinsics as uninitialized once they are inlined (GCC PR 105593)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+inline constexpr const char* ISA = "avx512";
+inline constexpr size_t BLOCK = 16;
+
+inline __m512i widen8(const Qty* q) noexcept
+{
+	return _mm512_cvtepu32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(q)));
+}
+
+inline uint64_t block_sum(const Qty* q) noexcept
+{
+	const __m512i lo = widen8(q);
+	const __m512i hi = widen8(q + 8);
+	return static_cast<uint64_t>(_mm512_reduce_add_epi64(_mm512_add_epi64(lo, hi)));
+}
+
+inline uint64_t sum(const Qty* q, size_t n) noexcept
+{
+	__m512i acc = _mm512_setzero_si512();
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8)
+	{
+		acc = _mm512_add_epi64(acc, widen8(q + i));
+	}
+	return static_cast<uint64_t>(_mm512_reduce_add_epi64(acc)) + scalar::sum(q + i, n - i);
+}
+
+inline uint64_t index_weighted_sum(const Qty* q, size_t n) noexcept
+{
+	const __m512i step = _mm512_set1_epi64(8);
+	__m512i idx = _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0);
+	__m512i acc = _mm512_setzero_si512();
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8)
+	{
+		const __m512i v = widen8(q + i);
+		acc = _mm512_add_epi64(acc, _mm512_mul_epu32(v, idx));
+		idx = _mm512_add_epi64(idx, step);
+	}
+
+	uint64_t total = static_cast<uint64_t>(_mm512_reduce_add_epi64(acc));
+	for(; i<n; i++) total += i * q[i];
+	return total;
+}
+
+#pragma GCC diagnostic pop
+
+#elif defined(__AVX2__)
+
+inline constexpr const char* ISA = "avx2";
+inline constexpr size_t BLOCK = 8;
+
+inline uint64_t horizontal_sum(__m256i v) noexcept
+{
+	const __m128i s = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+	return static_cast<uint64_t>(_mm_cvtsi128_si64(s)) + static_cast<uint64_t>(_mm_extract_epi64(s, 1));
+}
+
+inline __m256i widen4(const Qty* q) noexcept
+{
+	return _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(q)));
+}
+
+inline uint64_t block_sum(const Qty* q) noexcept
+{
+	return horizontal_sum(_mm256_add_epi64(widen4(q), widen4(q + 4)));
+}
+
+inline uint64_t sum(const Qty* q, size_t n) noexcept
+{
+	__m256i acc = _mm256_setzero_si256();
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8)
+	{
+		acc = _mm256_add_epi64(acc, _mm256_add_epi64(widen4(q + i), widen4(q + i + 4)));
+	}
+	return horizontal_sum(acc) + scalar::sum(q + i, n - i);
+}
+
+inline uint64_t index_weighted_sum(const Qty* q, size_t n) noexcept
+{
+	const __m256i step = _mm256_set1_epi64x(4);
+	__m256i idx = _mm256_set_epi64x(3, 2, 1, 0);
+	__m256i acc = _mm256_setzero_si256();
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4)
+	{
+		acc = _mm256_add_epi64(acc, _mm256_mul_epu32(widen4(q + i), idx));
+		idx = _mm256_add_epi64(idx, step);
+	}
+
+	uint64_t total = horizontal_sum(acc);
+	for(; i<n; i++) total += i * q[i];
+	return total;
+}
+
+#else
+
+inline constexpr const char* ISA = "scalar";
+
+inline uint64_t sum(const Qty* q, size_t n) noexcept { return scalar::sum(q, n); }
+inline uint64_t index_weighted_sum(const Qty* q, size_t n) noexcept { return scalar::index_weighted_sum(q, n); }
+inline FillPoint find_fill(const Qty* q, size_t n, uint64_t target) noexcept { return scalar::find_fill(q, n, target); }
+inline FillPoint find_fill_reverse(const Qty* q, size_t n, uint64_t target) noexcept { return scalar::find_fill_reverse(q, n, target); }
+
+#endif
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+
+// Whole blocks are skipped on their vector sum; only the block that reaches
+// the target is scanned level by level.
+inline FillPoint find_fill(const Qty* q, size_t n, uint64_t target) noexcept
+{
+	uint64_t before = 0;
+	size_t i = 0;
+	for(; i + BLOCK <= n; i += BLOCK)
+	{
+		const uint64_t block = block_sum(q + i);
+		if(before + block >= target) break;
+		before += block;
+	}
+
+	FillPoint rest = scalar::find_fill(q + i, n - i, target - before);
+	return { i + rest.index, before + rest.before };
+}
+
+inline FillPoint find_fill_reverse(const Qty* q, size_t n, uint64_t target) noexcept
+{
+	uint64_t before = 0;
+	size_t end = n;
+	for(; end >= BLOCK; end -= BLOCK)
+	{
+		const uint64_t block = block_sum(q + end - BLOCK);
+		if(before + block >= target) break;
+		before += block;
+	}
+
+	FillPoint rest = scalar::find_fill_reverse(q, end, target - before);
+	return { rest.index == end ? n : rest.index, before + rest.before };
+}
+
+#endif
+
+} // namespace depth_kernels
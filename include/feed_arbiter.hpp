@@ -0,0 +1,127 @@
+#pragma once
+#include "market_event.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// One packet as a feed line carries it. Redundant lines (A/B) carry the same
+// seq for the same event; seq starts at 1.
+struct SequencedEvent
+{
+	uint64_t seq;
+	MarketEvent ev;
+};
+
+// Merges redundant feed lines into one stream in seq order. Whichever line
+// delivers a seq first wins, later copies are dropped, and packets that arrive
+// ahead of a missing one wait in a fixed reorder window until it shows up on
+// either line. Nothing allocates after construction.
+//
+// A seq missing on every line is given up on once a packet arrives more than
+// Window past it, or when the caller calls flush() (e.g. after a timeout); it
+// is counted in lost() and the stream resumes behind it. Single-threaded: run
+// it on its own thread between the feed lines and the book.
+template <size_t Window = 256>
+class FeedArbiter
+{
+private:
+	static_assert(Window != 0 && (Window & (Window - 1)) == 0, "window must be a power of two");
+	static constexpr size_t MASK = Window - 1;
+
+	uint64_t next_seq_ = 1;
+	size_t buffered_ = 0;
+	std::array<uint64_t, Window> slot_seq_{}; // seq held in each slot, 0 when empty
+	std::array<MarketEvent, Window> slots_{};
+
+	uint64_t duplicates_ = 0;
+	uint64_t reordered_ = 0;
+	uint64_t lost_ = 0;
+
+	// Moves past next_seq_, emitting it if it was buffered.
+	template <typename Sink>
+	void advance(Sink& sink)
+	{
+		const size_t slot = next_seq_ & MASK;
+		if(slot_seq_[slot] == next_seq_)
+		{
+			slot_seq_[slot] = 0;
+			buffered_--;
+			sink(slots_[slot]);
+		}
+		else
+		{
+			lost_++;
+		}
+		next_seq_++;
+	}
+
+	// emits the buffered run that continues from next_seq_
+	template <typename Sink>
+	void drain(Sink& sink)
+	{
+		while(buffered_ > 0 && slot_seq_[next_seq_ & MASK] == next_seq_) advance(sink);
+	}
+
+public:
+	// Feeds one packet from any line; sink(const MarketEvent&) receives every
+	// event that is now in order.
+	template <typename Sink>
+	void on_packet(const SequencedEvent& packet, Sink&& sink)
+	{
+		const uint64_t seq = packet.seq;
+		if(seq < next_seq_)
+		{
+			duplicates_++;
+			return;
+		}
+
+		if(seq - next_seq_ >= Window)
+		{
+			// out of window: give up on the oldest missing seqs until it fits
+			while(buffered_ > 0 && seq - next_seq_ >= Window) advance(sink);
+			if(seq - next_seq_ >= Window)
+			{
+				const uint64_t skip = seq - next_seq_ - (Window - 1);
+				lost_ += skip;
+				next_seq_ += skip;
+			}
+			drain(sink);
+		}
+
+		if(seq == next_seq_)
+		{
+			next_seq_++;
+			sink(packet.ev);
+			drain(sink);
+			return;
+		}
+
+		const size_t slot = seq & MASK;
+		if(slot_seq_[slot] == seq)
+		{
+			duplicates_++;
+			return;
+		}
+
+		slot_seq_[slot] = seq;
+		slots_[slot] = packet.ev;
+		buffered_++;
+		reordered_++;
+	}
+
+	// Gives up on whatever is still missing and emits everything buffered.
+	template <typename Sink>
+	void flush(Sink&& sink)
+	{
+		while(buffered_ > 0) advance(sink);
+	}
+
+	// next seq the book is waiting for
+	uint64_t expected() const noexcept { return next_seq_; }
+	size_t buffered() const noexcept { return buffered_; }
+
+	uint64_t duplicates() const noexcept { return duplicates_; }
+	uint64_t reordered() const noexcept { return reordered_; } // arrived ahead of a missing seq
+	uint64_t lost() const noexcept { return lost_; }           // missing on every line
+};
@@ -0,0 +1,155 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// Fixed-memory log-linear latency histogram. Values below 2^SubBucketBits
+// are counted exactly; above that every power-of-two range is split into
+// 2^(SubBucketBits - 1) linear buckets, so a reported value is within
+// 2^-(SubBucketBits - 1) of the recorded one (< 1% at the default of 8).
+//
+// One thread owns an instance and records into it without any RMW; other
+// threads may read percentiles from it at any time and see a slightly stale
+// but never torn view. Per-thread instances are combined with merge_from().
+template <unsigned SubBucketBits = 8>
+class HdrHistogram
+{
+	static_assert(SubBucketBits >= 2 && SubBucketBits < 32);
+
+public:
+	static constexpr size_t SUB_BUCKETS = size_t{1} << SubBucketBits;
+	static constexpr size_t HALF = SUB_BUCKETS / 2;
+	static constexpr size_t BUCKETS = SUB_BUCKETS + (64 - SubBucketBits) * HALF;
+
+private:
+	std::atomic<uint64_t> counts_[BUCKETS]{};
+	std::atomic<uint64_t> total_{0};
+	std::atomic<uint64_t> min_{std::numeric_limits<uint64_t>::max()};
+	std::atomic<uint64_t> max_{0};
+
+public:
+	HdrHistogram() = default;
+	HdrHistogram(const HdrHistogram&) = delete;
+	HdrHistogram& operator=(const HdrHistogram&) = delete;
+
+	// Owning thread only
+	void record(uint64_t value) noexcept
+	{
+		bump(counts_[index_of(value)], 1);
+		bump(total_, 1);
+		if(value < min_.load(std::memory_order_relaxed)) min_.store(value, std::memory_order_relaxed);
+		if(value > max_.load(std::memory_order_relaxed)) max_.store(value, std::memory_order_relaxed);
+	}
+
+	// Adds another histogram's counts into this one. Safe against concurrent
+	// merges into the same target, but not against record() on it.
+	void merge_from(const HdrHistogram& other) noexcept
+	{
+		for(size_t i=0; i<BUCKETS; i++)
+		{
+			const uint64_t c = other.counts_[i].load(std::memory_order_relaxed);
+			if(c) counts_[i].fetch_add(c, std::memory_order_relaxed);
+		}
+		total_.fetch_add(other.total_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+		const uint64_t lo = other.min_.load(std::memory_order_relaxed);
+		uint64_t cur = min_.load(std::memory_order_relaxed);
+		while(lo < cur && !min_.compare_exchange_weak(cur, lo, std::memory_order_relaxed)) {}
+
+		const uint64_t hi = other.max_.load(std::memory_order_relaxed);
+		cur = max_.load(std::memory_order_relaxed);
+		while(hi > cur && !max_.compare_exchange_weak(cur, hi, std::memory_order_relaxed)) {}
+	}
+
+	// Owning thread only, e.g. between reporting intervals
+	void reset() noexcept
+	{
+		for(auto& c : counts_) c.store(0, std::memory_order_relaxed);
+		total_.store(0, std::memory_order_relaxed);
+		min_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+		max_.store(0, std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] uint64_t count() const noexcept { return total_.load(std::memory_order_relaxed); }
+
+	[[nodiscard]] uint64_t min() const noexcept
+	{
+		return count() ? min_.load(std::memory_order_relaxed) : 0;
+	}
+
+	[[nodiscard]] uint64_t max() const noexcept { return max_.load(std::memory_order_relaxed); }
+
+	// Value at quantile p in (0, 1]: the top of the bucket holding that
+	// sample, clamped to max().
+	[[nodiscard]] uint64_t value_at(double p) const noexcept
+	{
+		uint64_t seen = 0;
+		uint64_t total = 0;
+		for(size_t i=0; i<BUCKETS; i++) total += counts_[i].load(std::memory_order_relaxed);
+		if(total == 0) return 0;
+
+		uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(total) + 0.5);
+		if(rank == 0) rank = 1;
+		if(rank > total) rank = total;
+
+		for(size_t i=0; i<BUCKETS; i++)
+		{
+			seen += counts_[i].load(std::memory_order_relaxed);
+			if(seen >= rank)
+			{
+				const uint64_t top = highest_in(i);
+				const uint64_t hi = max();
+				return top < hi ? top : hi;
+			}
+		}
+		return max();
+	}
+
+	[[nodiscard]] double mean() const noexcept
+	{
+		double sum = 0.0;
+		uint64_t total = 0;
+		for(size_t i=0; i<BUCKETS; i++)
+		{
+			const uint64_t c = counts_[i].load(std::memory_order_relaxed);
+			if(!c) continue;
+			sum += static_cast<double>(c) * (static_cast<double>(lowest_in(i)) + static_cast<double>(highest_in(i))) / 2.0;
+			total += c;
+		}
+		return total ? sum / static_cast<double>(total) : 0.0;
+	}
+
+	static constexpr size_t index_of(uint64_t value) noexcept
+	{
+		if(value < SUB_BUCKETS) return static_cast<size_t>(value);
+
+		const unsigned shift = static_cast<unsigned>(std::bit_width(value)) - SubBucketBits;
+		const size_t top = static_cast<size_t>(value >> shift); // in [HALF, SUB_BUCKETS)
+		return SUB_BUCKETS + (shift - 1) * HALF + (top - HALF);
+	}
+
+	static constexpr uint64_t lowest_in(size_t index) noexcept
+	{
+		if(index < SUB_BUCKETS) return index;
+
+		const size_t shift = (index - SUB_BUCKETS) / HALF + 1;
+		const uint64_t top = (index - SUB_BUCKETS) % HALF + HALF;
+		return top << shift;
+	}
+
+	static constexpr uint64_t highest_in(size_t index) noexcept
+	{
+		if(index < SUB_BUCKETS) return index;
+
+		const size_t shift = (index - SUB_BUCKETS) / HALF + 1;
+		return lowest_in(index) + ((uint64_t{1} << shift) - 1);
+	}
+
+private:
+	static void bump(std::atomic<uint64_t>& a, uint64_t n) noexcept
+	{
+		a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+};
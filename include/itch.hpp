@@ -0,0 +1,125 @@
+#pragma once
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Zero-copy decoder for NASDAQ TotalView-ITCH 5.0 in BinaryFILE framing
+// (each message prefixed with a 2-byte big-endian length). Fields are read
+// straight out of the mapped buffer; only the order-book messages are
+// surfaced, everything else is skipped by length.
+namespace itch {
+
+// Fields shared by every message
+struct Header
+{
+	char type;
+	uint16_t stock_locate;
+	uint64_t timestamp_ns; // nanoseconds since midnight
+};
+
+inline uint16_t be16(const uint8_t* p) noexcept
+{
+	return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint32_t be32(const uint8_t* p) noexcept
+{
+	uint32_t v;
+	std::memcpy(&v, p, sizeof(v));
+	return __builtin_bswap32(v);
+}
+
+inline uint64_t be48(const uint8_t* p) noexcept
+{
+	return (uint64_t{be16(p)} << 32) | be32(p + 2);
+}
+
+inline uint64_t be64(const uint8_t* p) noexcept
+{
+	uint64_t v;
+	std::memcpy(&v, p, sizeof(v));
+	return __builtin_bswap64(v);
+}
+
+inline Header header(const uint8_t* msg) noexcept
+{
+	return { static_cast<char>(msg[0]), be16(msg + 1), be48(msg + 5) };
+}
+
+// Handler interface (all members required):
+//   on_directory(h, const char (&stock)[8])
+//   on_add(h, order_ref, side, shares, price)
+//   on_execute(h, order_ref, shares)             'E'
+//   on_execute_at(h, order_ref, shares, price)   'C'
+//   on_cancel(h, order_ref, shares)              'X' partial cancel
+//   on_delete(h, order_ref)                      'D'
+//   on_replace(h, old_ref, new_ref, shares, price)
+template <typename Handler>
+inline void dispatch(const uint8_t* msg, size_t len, Handler& handler) noexcept
+{
+	const Header h = header(msg);
+
+	switch(h.type)
+	{
+	case 'R':
+		if(len >= 19)
+		{
+			char stock[8];
+			std::memcpy(stock, msg + 11, sizeof(stock));
+			handler.on_directory(h, stock);
+		}
+		break;
+	case 'A':
+	case 'F':
+		if(len >= 36)
+		{
+			const Side side = msg[19] == 'B' ? Side::BID : Side::ASK;
+			handler.on_add(h, be64(msg + 11), side, be32(msg + 20), be32(msg + 32));
+		}
+		break;
+	case 'E':
+		if(len >= 31) handler.on_execute(h, be64(msg + 11), be32(msg + 19));
+		break;
+	case 'C':
+		if(len >= 36) handler.on_execute_at(h, be64(msg + 11), be32(msg + 19), be32(msg + 32));
+		break;
+	case 'X':
+		if(len >= 23) handler.on_cancel(h, be64(msg + 11), be32(msg + 19));
+		break;
+	case 'D':
+		if(len >= 19) handler.on_delete(h, be64(msg + 11));
+		break;
+	case 'U':
+		if(len >= 35) handler.on_replace(h, be64(msg + 11), be64(msg + 19), be32(msg + 27), be32(msg + 31));
+		break;
+	default:
+		break;
+	}
+}
+
+// Walks a BinaryFILE buffer. Returns the number of framed messages seen; a
+// truncated trailing message is ignored.
+template <typename Handler>
+inline uint64_t decode(const uint8_t* data, size_t size, Handler& handler) noexcept
+{
+	uint64_t count = 0;
+	size_t pos = 0;
+
+	while(pos + 2 <= size)
+	{
+		const size_t len = be16(data + pos);
+		const uint8_t* msg = data + pos + 2;
+		if(len == 0 || pos + 2 + len > size) break;
+
+		if(pos + 2 + len + 64 <= size) __builtin_prefetch(msg + len + 64);
+		dispatch(msg, len, handler);
+
+		pos += 2 + len;
+		count++;
+	}
+	return count;
+}
+
+} // namespace itch
@@ -10,9 +10,9 @@
 #include <algorithm>
 #include <x86intrin.h>
 
-int cpu_count = std::thread::hardware_concurrency();
+inline int cpu_count = static_cast<int>(std::thread::hardware_concurrency());
 
-void pin_thread_to_core(int core_id) {
+inline void pin_thread_to_core(int core_id) {
     cpu_set_t cpuset;
     CPU_ZERO(&cpuset);
 
@@ -34,7 +34,7 @@ static inline uint64_t monotonic_raw_ns() {
     return uint64_t(ts.tv_sec) * 1'000'000'000ull + ts.tv_nsec;
 }
 
-double calibrate_ghz() {
+inline double calibrate_ghz() {
     // pin calibration thread
     pin_thread_to_core(0);
 
@@ -63,7 +63,7 @@ double calibrate_ghz() {
     return freqs[samples / 2]; // median
 }
 
-double cycles_to_ns(uint64_t cycles, double ghz) {
+inline double cycles_to_ns(uint64_t cycles, double ghz) {
     double freq_hz = ghz * 1e9;
     double seconds = double(cycles) / freq_hz;
     return seconds * 1e9;
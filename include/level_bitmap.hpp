@@ -0,0 +1,127 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// Three-level occupancy summary over N slots. Bit i of l0_ marks slot i as
+// occupied, bit j of l1_ marks l0_[j] as non-zero and the single top word marks
+// non-zero l1_ words, so a nearest-set-bit search costs at most three
+// tzcnt/lzcnt steps regardless of how many empty slots lie in between.
+template <std::size_t N>
+class LevelBitmap
+{
+private:
+	static constexpr std::size_t BITS = 64;
+	static constexpr std::size_t L0_WORDS = (N + BITS - 1) / BITS;
+	static constexpr std::size_t L1_WORDS = (L0_WORDS + BITS - 1) / BITS;
+
+	static_assert(N > 0, "bitmap needs at least one slot");
+	static_assert(L1_WORDS <= BITS, "N exceeds 64^3 slots");
+
+	std::array<uint64_t, L0_WORDS> l0_{};
+	std::array<uint64_t, L1_WORDS> l1_{};
+	uint64_t l2_ = 0;
+
+public:
+	void set(std::size_t i) noexcept
+	{
+		const std::size_t w0 = i / BITS;
+		const std::size_t w1 = w0 / BITS;
+		l0_[w0] |= bit(i);
+		l1_[w1] |= bit(w0);
+		l2_ |= bit(w1);
+	}
+
+	void clear(std::size_t i) noexcept
+	{
+		const std::size_t w0 = i / BITS;
+		const std::size_t w1 = w0 / BITS;
+		l0_[w0] &= ~bit(i);
+		if(l0_[w0] != 0) return;
+
+		l1_[w1] &= ~bit(w0);
+		if(l1_[w1] != 0) return;
+
+		l2_ &= ~bit(w1);
+	}
+
+	[[nodiscard]] bool test(std::size_t i) const noexcept
+	{
+		return (l0_[i / BITS] & bit(i)) != 0;
+	}
+
+	[[nodiscard]] bool empty() const noexcept { return l2_ == 0; }
+
+	// lowest occupied slot >= i, or -1
+	[[nodiscard]] int find_next(std::size_t i) const noexcept
+	{
+		if(i >= N) return -1;
+
+		std::size_t w0 = i / BITS;
+		uint64_t word = l0_[w0] & (~uint64_t{0} << (i % BITS));
+		if(word) return to_index(w0, lowest(word));
+
+		std::size_t w1 = w0 / BITS;
+		word = l1_[w1] & above(w0 % BITS);
+		if(!word)
+		{
+			word = l2_ & above(w1);
+			if(!word) return -1;
+			w1 = lowest(word);
+			word = l1_[w1];
+		}
+		w0 = w1 * BITS + lowest(word);
+		return to_index(w0, lowest(l0_[w0]));
+	}
+
+	// highest occupied slot <= i, or -1
+	[[nodiscard]] int find_prev(std::size_t i) const noexcept
+	{
+		if(i >= N) i = N - 1;
+
+		std::size_t w0 = i / BITS;
+		uint64_t word = l0_[w0] & at_or_below(i % BITS);
+		if(word) return to_index(w0, highest(word));
+
+		std::size_t w1 = w0 / BITS;
+		word = l1_[w1] & below(w0 % BITS);
+		if(!word)
+		{
+			word = l2_ & below(w1);
+			if(!word) return -1;
+			w1 = highest(word);
+			word = l1_[w1];
+		}
+		w0 = w1 * BITS + highest(word);
+		return to_index(w0, highest(l0_[w0]));
+	}
+
+private:
+	static constexpr uint64_t bit(std::size_t i) noexcept { return uint64_t{1} << (i % BITS); }
+
+	// bits strictly above / strictly below / at-or-below position b
+	static constexpr uint64_t above(std::size_t b) noexcept
+	{
+		return b + 1 == BITS ? 0 : ~uint64_t{0} << (b + 1);
+	}
+	static constexpr uint64_t below(std::size_t b) noexcept { return bit(b) - 1; }
+	static constexpr uint64_t at_or_below(std::size_t b) noexcept
+	{
+		return b + 1 == BITS ? ~uint64_t{0} : bit(b + 1) - 1;
+	}
+
+	static std::size_t lowest(uint64_t word) noexcept
+	{
+		return static_cast<std::size_t>(std::countr_zero(word));
+	}
+	static std::size_t highest(uint64_t word) noexcept
+	{
+		return BITS - 1 - static_cast<std::size_t>(std::countl_zero(word));
+	}
+
+	static int to_index(std::size_t w0, std::size_t b) noexcept
+	{
+		return static_cast<int>(w0 * BITS + b);
+	}
+};
@@ -1,8 +1,2 @@
 #pragma once
-#include "types.hpp"
-
-struct TopOfBook {
-        Price best_bid;
-        Price best_ask;
-        Price spread;
-};
+#include "types.hpp" // TopOfBook
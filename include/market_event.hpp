@@ -1,15 +1,24 @@
 #pragma once
 #include "types.hpp"
 
+// Everything but Add refers to a resting order by id alone; price and side
+// are only read where listed.
 enum class EventType : uint8_t {
-        Add,
-        Cancel,
-        Trade
+        Add,     // new resting/aggressing order: id, side, price, qty
+        Cancel,  // remove order id
+        Modify,  // set order id to qty (an increase loses priority)
+        Trade,   // order id executed for qty
+        Reduce,  // take qty off order id (partial cancel)
+        Replace  // move order id to price with qty, re-keyed to new_order_id if non-zero
 };
 
 struct MarketEvent {
-        EventType type;
+        uint64_t order_id;
         Price price;
         Qty qty;
-        bool is_bid;
+        EventType type;
+        Side side;
+        uint64_t new_order_id = 0;
 };
+
+static_assert(sizeof(MarketEvent) == 32);
@@ -8,7 +8,10 @@
 #include <stdexcept>
 #include <memory>
 
-template<typename T, typename Alloc = std::allocator<T>>
+#include "wait_strategy.hpp"
+
+// Wait is what pop_wait() does while the queue is empty, see wait_strategy.hpp.
+template<typename T, typename Alloc = std::allocator<T>, typename Wait = BusySpin>
 class mpmc
 {
 private:
@@ -37,6 +40,8 @@ private:
 	alignas(64) std::atomic<size_t> tail_{0}; // write
 	char pad3[64 - sizeof(std::atomic<size_t>)];
 
+	[[no_unique_address]] Wait wait_;
+
 public:
 	explicit mpmc(size_t size_pow2, const Alloc& alloc = Alloc())
 	: alloc_(alloc),
@@ -108,9 +113,100 @@ public:
 		}
 	}
 
+	// Pushes up to n items, claiming the whole run of free slots with a single
+	// CAS on tail_ rather than one per item. Returns how many were pushed,
+	// 0 if the queue is full.
+	size_t try_push_n(const T* items, size_t n) noexcept {
+		if(n == 0) return 0;
+		size_t pos = tail_.load(std::memory_order_relaxed);
+		while(true) {
+			const size_t count = run_length(pos, n, 0);
+			if(count == 0) {
+				const size_t seq = ctrl_[pos & mask_].seq.load(std::memory_order_acquire);
+				if(static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos) < 0) {
+					return 0;
+				}
+				pos = tail_.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			if(tail_.compare_exchange_weak(pos, pos+count, std::memory_order_relaxed, std::memory_order_relaxed)) {
+				for(size_t i=0; i<count; i++) {
+					const size_t idx = (pos+i) & mask_;
+					new (storage_ptr(data_[idx])) T(items[i]);
+					ctrl_[idx].seq.store(pos+i+1, std::memory_order_release);
+				}
+				wait_.notify();
+				return count;
+			}
+			// CAS failed -> pos updated, rescan from there
+		}
+	}
+
+	// Pops up to n items, claiming the whole run of produced slots with a
+	// single CAS on head_. Returns how many were popped, 0 if empty.
+	size_t try_pop_n(T* out, size_t n) noexcept {
+		if(n == 0) return 0;
+		size_t pos = head_.load(std::memory_order_relaxed);
+		while(true) {
+			const size_t count = run_length(pos, n, 1);
+			if(count == 0) {
+				const size_t seq = ctrl_[pos & mask_].seq.load(std::memory_order_acquire);
+				if(static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos+1) < 0) {
+					return 0;
+				}
+				pos = head_.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			if(head_.compare_exchange_weak(pos, pos+count, std::memory_order_relaxed, std::memory_order_relaxed)) {
+				for(size_t i=0; i<count; i++) {
+					const size_t idx = (pos+i) & mask_;
+					T* src = storage_ptr(data_[idx]);
+					out[i] = std::move(*src);
+					src->~T();
+					ctrl_[idx].seq.store(pos+i+size_, std::memory_order_release);
+				}
+				return count;
+			}
+		}
+	}
+
+	// Pops, idling on the wait strategy while the queue is empty. Returns false
+	// only once stop() holds and the queue is drained; whoever makes stop()
+	// true must call notify() afterwards.
+	template <typename Stop>
+	bool pop_wait(T& out, Stop&& stop) noexcept {
+		while(!pop(out)) {
+			if(stop()) return pop(out);
+			wait_.wait([&]() { return !empty() || stop(); });
+		}
+		return true;
+	}
+
+	// Wakes consumers idling in pop_wait(). Pushes do this themselves.
+	void notify() noexcept { wait_.notify(); }
+
+	// true if the next slot to pop has not been produced yet
+	bool empty() const noexcept {
+		const size_t pos = head_.load(std::memory_order_acquire);
+		return ctrl_[pos & mask_].seq.load(std::memory_order_acquire) != pos + 1;
+	}
+
 	size_t capacity() const noexcept { return size_; };
 
 private:
+	// Number of consecutive cells from pos (at most n) whose seq reads
+	// pos+i+offset: free for a producer at offset 0, produced for a consumer
+	// at offset 1.
+	size_t run_length(size_t pos, size_t n, size_t offset) const noexcept {
+		size_t count = 0;
+		while(count < n && ctrl_[(pos+count) & mask_].seq.load(std::memory_order_acquire) == pos+count+offset) {
+			count++;
+		}
+		return count;
+	}
+
 	// internal emplace to avoid code duplication
 	template<typename... Args>
 	bool emplace(Args&&... args) noexcept {
@@ -122,12 +218,12 @@ private:
 			ptrdiff_t diff = static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos);
 
 			if(__builtin_expect(diff == 0,1)) {
-				size_t old_pos = pos;
 				if(tail_.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed, std::memory_order_relaxed)) {
 					T* dest = storage_ptr(data_[idx]);
 					new (dest) T(std::forward<Args>(args)...);
 
 					c.seq.store(pos+1, std::memory_order_release);
+					wait_.notify();
 					return true;
 				}
 				continue;		
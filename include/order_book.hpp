@@ -1,100 +1,231 @@
 #pragma once
 #include "book_side.hpp"
+#include "book_traits.hpp"
 #include "market_event.hpp"
+#include "order_index.hpp"
 #include "orderbook_listener.hpp"
 #include "OrderPool.hpp"
+#include "seqlock.hpp"
 #include "types.hpp"
-#include "absl/container/flat_hash_map.h"
 
+#include <span>
+#include <utility>
 #include <vector>
 #include <chrono>
 
+// Traits fixes the order index, listener dispatch, ladder size, snapshot
+// depth and (optionally) the tick at compile time, see book_traits.hpp.
+template <typename Traits = DefaultBookTraits>
 class OrderBook
 {
-private:
-	BookSide<Side::BID, MAX_PRICE_LEVELS> bids_;
-	BookSide<Side::ASK, MAX_PRICE_LEVELS> asks_;
+public:
+	using Index = typename Traits::Index;
+	using Listeners = typename Traits::Listeners;
 
-	absl::flat_hash_map<uint64_t, Order*> order_map_;
+	static constexpr size_t DEPTH_LEVELS = Traits::DEPTH_LEVELS;
+
+private:
 	OrderPool pool_;
+
+	BookSide<Side::BID, Traits::LADDER_LEVELS, Traits::TICK_SIZE> bids_;
+	BookSide<Side::ASK, Traits::LADDER_LEVELS, Traits::TICK_SIZE> asks_;
+
+	Index order_map_;
 	
-	std::vector<IOrderBookListener*> listeners_;
+	Listeners listeners_;
 
 public:
-	OrderBook(Price bid_base, Price ask_base, Price tick_size, size_t order_pool_capacity)
-		: bids_(bid_base, tick_size), 
-		  asks_(ask_base, tick_size), 
-		  pool_(order_pool_capacity) {}
+	// `listeners` seeds the dispatch policy, for sinks that need constructor
+	// arguments (see StaticListeners).
+	OrderBook(Price bid_base, Price ask_base, Price tick_size, size_t order_pool_capacity, Index order_index = Index{}, Listeners listeners = Listeners{})
+		: pool_(order_pool_capacity),
+		  bids_(bid_base, tick_size, pool_), 
+		  asks_(ask_base, tick_size, pool_), 
+		  order_map_(std::move(order_index)),
+		  listeners_(std::move(listeners)) {}
+
+	OrderBook(Price bid_base, Price ask_base, Price tick_size, const OrderPoolConfig& pool_config, Index order_index = Index{}, Listeners listeners = Listeners{})
+		: pool_(pool_config),
+		  bids_(bid_base, tick_size, pool_),
+		  asks_(ask_base, tick_size, pool_),
+		  order_map_(std::move(order_index)),
+		  listeners_(std::move(listeners)) {}
 
-	void add_order(uint64_t order_id, Price price, Qty qty, Side side) noexcept
+	AddResult add_order(uint64_t order_id, Price price, Qty qty, Side side) noexcept
 	{
-		Order* order = pool_.allocate();
-		if(!order) return;
+		// an off-grid order must not trade before it is rejected
+		const bool on_grid = side == Side::BID ? bids_.on_grid(price) : asks_.on_grid(price);
+		if(!on_grid) return AddResult::InvalidPrice;
 
-		order->order_id = order_id;
-		order->quantity = qty;
-		order->side = side;
+		auto on_fill = [this, order_id, side](Order* maker, Qty fill_qty, Price fill_price) noexcept
+		{
+			handle_fill(maker, fill_qty, fill_price, order_id, side);
+		};
 
 		if(side == Side::BID)
 		{
-			bids_.add_order(order, price);
+			qty = asks_.match(price, qty, on_fill);
 		}
 		else
 		{
-			asks_.add_order(order, price);
+			qty = bids_.match(price, qty, on_fill);
 		}
 
-		order_map_[order_id] = order;
-		notify_if_best_changed();
+		if(qty == 0)
+		{
+			publish_updates();
+			return AddResult::Filled;
+		}
+
+		return rest(order_id, price, qty, side);
 	}
 
-	void cancel_order(uint64_t order_id, Price price) noexcept
+	// Feed-driven add: the venue has done the matching, so the order only
+	// rests, even where it locks or crosses the book (as it does around the
+	// opening and closing crosses).
+	AddResult rest_order(uint64_t order_id, Price price, Qty qty, Side side) noexcept
 	{
-		auto it = order_map_.find(order_id);
-		if(it == order_map_.end()) return;
+		const bool on_grid = side == Side::BID ? bids_.on_grid(price) : asks_.on_grid(price);
+		if(!on_grid) return AddResult::InvalidPrice;
 
-		Order* order = it->second;
-		Side side = order->side;
+		return rest(order_id, price, qty, side);
+	}
 
-		if(side == Side::BID)
-		{
-			bids_.remove_order(order, price);
-		}
-		else
+	// Cancel, modify, replace, reduce and execute find the order and its
+	// level from the id alone.
+	void cancel_order(uint64_t order_id) noexcept
+	{
+		Order* order = order_map_.find(order_id);
+		if(!order) return;
+
+		const Side side = order->side;
+		const Price price = price_of(*order);
+		emit_order(DeltaType::OrderCancel, order, price, order->quantity);
+		remove_resting(order, price);
+		emit_level(side, price);
+		publish_updates();
+	}
+
+	// A reduce keeps queue priority, an increase goes to the back of the
+	// level; zero cancels.
+	void modify_order(uint64_t order_id, Qty new_qty) noexcept
+	{
+		Order* order = order_map_.find(order_id);
+		if(!order) return;
+
+		if(new_qty == 0)
 		{
-			asks_.remove_order(order, price);
+			cancel_order(order_id);
+			return;
 		}
 
-		order_map_.erase(it);
+		const Price price = price_of(*order);
+		resize_resting(order, price, new_qty);
+		emit_order(DeltaType::OrderModify, order, price, new_qty);
+		emit_level(order->side, price);
+		publish_updates();
+	}
 
-		pool_.deallocate(order);
+	// Takes `qty` off a resting order (a partial cancel), removing it if
+	// nothing is left. Keeps queue priority.
+	void reduce_order(uint64_t order_id, Qty qty) noexcept
+	{
+		Order* order = order_map_.find(order_id);
+		if(!order) return;
 
-		notify_if_best_changed();
+		modify_order(order_id, qty >= order->quantity ? 0 : order->quantity - qty);
+	}
+	
+	// Cancel/replace in one call. The order keeps its pool slot and, unless
+	// it is re-keyed to a non-zero new_order_id, its index entry. Keeping
+	// price and id follows modify_order; otherwise the order goes to the back
+	// of the new level, trading first if new_price crosses the other side.
+	// A bad new_price, or a new_order_id that is already live, is rejected
+	// (InvalidPrice / DuplicateOrder) and leaves the order untouched. A zero
+	// new_qty cancels the order and returns Cancelled, never Filled.
+	AddResult replace_order(uint64_t order_id, Price new_price, Qty new_qty, uint64_t new_order_id = 0) noexcept
+	{
+		Order* order = order_map_.find(order_id);
+		if(!order) return AddResult::UnknownOrder;
+
+		if(order->side == Side::BID) return replace_on<true>(bids_, asks_, order, new_price, new_qty, new_order_id);
+		return replace_on<true>(asks_, bids_, order, new_price, new_qty, new_order_id);
 	}
 
-	void modify_order(uint64_t order_id, Price price, Qty new_qty)
+	// replace_order for a feed-driven replace: the order only rests at its new
+	// price, like rest_order.
+	AddResult rest_replace_order(uint64_t order_id, Price new_price, Qty new_qty, uint64_t new_order_id = 0) noexcept
 	{
-		auto it = order_map_.find(order_id);
-		if(it == order_map_.end()) return;
+		Order* order = order_map_.find(order_id);
+		if(!order) return AddResult::UnknownOrder;
 
-		Order* order = it->second;
-		Side side = order->side;
+		if(order->side == Side::BID) return replace_on<false>(bids_, asks_, order, new_price, new_qty, new_order_id);
+		return replace_on<false>(asks_, bids_, order, new_price, new_qty, new_order_id);
+	}
 
-		if(side == Side::BID)
+	// Reduces a resting order by an execution reported by the feed, removing it
+	// once fully executed.
+	void execute_order(uint64_t order_id, Qty qty) noexcept
+	{
+		Order* order = order_map_.find(order_id);
+		if(!order) return;
+
+		const Side side = order->side;
+		const Price price = price_of(*order);
+		const Qty fill = std::min(qty, order->quantity);
+		const Trade trade{
+			.maker_order_id = order_id,
+			.taker_order_id = 0,
+			.price = price,
+			.qty = fill,
+			.aggressor = side == Side::BID ? Side::ASK : Side::BID
+		};
+		listeners_.on_trade(trade);
+		emit_order(DeltaType::OrderExec, order, price, fill);
+
+		if(fill == order->quantity)
 		{
-			bids_.modify_order(order, price, new_qty);
+			remove_resting(order, price);
 		}
 		else
 		{
-			asks_.modify_order(order, price, new_qty);
+			resize_resting(order, price, order->quantity - fill);
 		}
 
-		notify_if_best_changed();
+		emit_level(side, price);
+		publish_updates();
 	}
-	
+
+	void on_event(const MarketEvent& ev) noexcept { apply<true>(ev); }
+
+	// on_event for a venue's order feed: adds and replaces only rest (see
+	// rest_order), since the feed reports the venue's own executions.
+	void on_feed_event(const MarketEvent& ev) noexcept { apply<false>(ev); }
+
+	// Applies a burst of events in order and returns how many of its adds were
+	// rejected (off-grid price or pool exhausted). While event i is applied,
+	// the index slot and (for adds and replaces) the price level of event
+	// i + PREFETCH_DISTANCE are already in flight.
+	size_t on_events(std::span<const MarketEvent> events) noexcept { return apply_all<true>(events); }
+	size_t on_feed_events(std::span<const MarketEvent> events) noexcept { return apply_all<false>(events); }
+
 	void add_listener(IOrderBookListener* listener) {
-        listeners_.push_back(listener);
-    }
+		listeners_.add(listener);
+	}
+
+	[[nodiscard]] Listeners& listeners() noexcept { return listeners_; }
+
+	[[nodiscard]] Price tick_size() const noexcept { return bids_.tick_size(); }
+
+	// Visits every resting order, bids then asks, best level first and in
+	// queue order within a level: f(order, price). Re-adding them in this
+	// order rebuilds the same book, queue priority included.
+	template <typename F>
+	void for_each_order(F&& f) const
+	{
+		bids_.for_each_order(f);
+		asks_.for_each_order(f);
+	}
 
 	[[nodiscard]] inline Price best_bid() const noexcept { return bids_.get_best_price(); }
 	[[nodiscard]] inline Price best_ask() const noexcept { return asks_.get_best_price(); }
@@ -109,44 +240,451 @@ public:
         return ask - bid;
 	}
 
-	MarketDepth get_depth() const noexcept {
-        MarketDepth depth{};
-        bids_.get_depth(depth.bids.data(), 5, depth.bid_levels);
-        asks_.get_depth(depth.asks.data(), 5, depth.ask_levels);
-        return depth;
-    }
+	// Walks the top N levels of each side now; book thread only
+	template <size_t N = DEPTH_LEVELS>
+	DepthSnapshot<N> get_depth() const noexcept {
+		DepthSnapshot<N> depth{};
+		bids_.get_depth(depth.bids.data(), N, depth.bid_levels);
+		asks_.get_depth(depth.asks.data(), N, depth.ask_levels);
+		return depth;
+	}
+
+	// Safe from any thread: copies a consistent top-DEPTH_LEVELS snapshot into
+	// `out` and returns its version (0 if nothing has been published yet).
+	uint64_t read_depth(DepthSnapshot<DEPTH_LEVELS>& out) const noexcept {
+		return depth_.load(out);
+	}
+
+	// Qty resting on `side` within `ticks` ticks of its best price
+	[[nodiscard]] uint64_t depth_within(Side side, uint32_t ticks) const noexcept
+	{
+		return side == Side::BID ? bids_.depth_within(ticks) : asks_.depth_within(ticks);
+	}
+
+	// Cost of sweeping `qty` off `side` (a buy sweeps the asks)
+	[[nodiscard]] FillEstimate estimate_sweep(Side side, uint64_t qty) const noexcept
+	{
+		return side == Side::BID ? bids_.estimate_sweep(qty) : asks_.estimate_sweep(qty);
+	}
 
+	// (bid - ask) / (bid + ask) over the depth within `ticks` ticks of each
+	// best; 0 when both are empty
+	[[nodiscard]] double depth_imbalance(uint32_t ticks) const noexcept
+	{
+		const double bid = static_cast<double>(bids_.depth_within(ticks));
+		const double ask = static_cast<double>(asks_.depth_within(ticks));
+		return bid + ask == 0 ? 0.0 : (bid - ask) / (bid + ask);
+	}
+
+	// top-level imbalance, (bid - ask) / (bid + ask)
 	double get_imbalance() const {
-		Qty bid_qty = best_bid_qty();
-		Qty ask_qty = best_ask_qty();
-		if (bid_qty == 0 && ask_qty == 0) return 0.0;
+		const double bid_qty = best_bid_qty();
+		const double ask_qty = best_ask_qty();
+		if (bid_qty + ask_qty == 0) return 0.0;
 
-		return static_cast<double>(bid_qty - ask_qty) / (bid_qty + ask_qty);
+		return (bid_qty - ask_qty) / (bid_qty + ask_qty);
+	}
+
+	// Near-touch signals as of the last book change, an O(1) read. Book
+	// thread only.
+	[[nodiscard]] const BookSignals& signals() const noexcept { return signals_; }
+
+	// Sets the tick windows behind BookSignals (10 and 5 by default) and
+	// recomputes them.
+	void set_signal_window(uint32_t depth_ticks, uint32_t weight_ticks) noexcept
+	{
+		bids_.set_signal_window(depth_ticks, weight_ticks);
+		asks_.set_signal_window(depth_ticks, weight_ticks);
+		update_signals();
 	}
 
 private:
+	static constexpr size_t PREFETCH_DISTANCE = 8;
+
 	Price last_best_bid_ = INVALID_PRICE;
 	Price last_best_ask_ = INVALID_PRICE;
+	Qty last_best_bid_qty_ = 0;
+	Qty last_best_ask_qty_ = 0;
+
+	uint64_t delta_seq_ = 0;
+
+	// book-thread copy of the last published snapshot, and which sides of it
+	// the current operation made stale
+	DepthSnapshot<DEPTH_LEVELS> depth_view_{};
+	bool bid_depth_dirty_ = false;
+	bool ask_depth_dirty_ = false;
+	Seqlock<DepthSnapshot<DEPTH_LEVELS>> depth_;
+
+	BookSignals signals_{};
+
+	void publish_updates() noexcept
+	{
+		update_signals();
+		notify_if_best_changed();
+		publish_depth_if_dirty();
+	}
+
+	// The sides keep their depth sums incrementally; this only redoes the
+	// ratios, and only when a sum moved.
+	void update_signals() noexcept
+	{
+		const bool bids_changed = bids_.refresh_signals();
+		const bool asks_changed = asks_.refresh_signals();
+		if(!bids_changed && !asks_changed) return;
+
+		auto ratio = [](double bid, double ask) { return bid + ask == 0 ? 0.0 : (bid - ask) / (bid + ask); };
+
+		signals_.bid_depth = bids_.near_depth();
+		signals_.ask_depth = asks_.near_depth();
+		signals_.depth_imbalance = ratio(static_cast<double>(signals_.bid_depth), static_cast<double>(signals_.ask_depth));
+
+		const uint64_t bid_weighted = bids_.weighted_depth();
+		const uint64_t ask_weighted = asks_.weighted_depth();
+		signals_.weighted_imbalance = ratio(static_cast<double>(bid_weighted), static_cast<double>(ask_weighted));
+		signals_.pressure = static_cast<int64_t>(bid_weighted) - static_cast<int64_t>(ask_weighted);
+
+		const Price bid = bids_.get_best_price();
+		const Price ask = asks_.get_best_price();
+		const double bid_qty = bids_.get_best_qty();
+		const double ask_qty = asks_.get_best_qty();
+		signals_.microprice = (bid == INVALID_PRICE || ask == INVALID_PRICE)
+			? 0.0
+			: (bid * ask_qty + ask * bid_qty) / (bid_qty + ask_qty);
+	}
+
+	// Marks a side's snapshot stale if `price` is one of its top DEPTH_LEVELS
+	// levels, or could become one. Levels deeper than that never trigger a
+	// republish.
+	void touch(Side side, Price price) noexcept
+	{
+		if(side == Side::BID)
+		{
+			const size_t n = depth_view_.bid_levels;
+			if(n < DEPTH_LEVELS || price >= depth_view_.bids[n - 1].price) bid_depth_dirty_ = true;
+		}
+		else
+		{
+			const size_t n = depth_view_.ask_levels;
+			if(n < DEPTH_LEVELS || price <= depth_view_.asks[n - 1].price) ask_depth_dirty_ = true;
+		}
+	}
+
+	void publish_depth_if_dirty() noexcept
+	{
+		if(!bid_depth_dirty_ && !ask_depth_dirty_) return;
+
+		if(bid_depth_dirty_) bids_.get_depth(depth_view_.bids.data(), DEPTH_LEVELS, depth_view_.bid_levels);
+		if(ask_depth_dirty_) asks_.get_depth(depth_view_.asks.data(), DEPTH_LEVELS, depth_view_.ask_levels);
+		bid_depth_dirty_ = ask_depth_dirty_ = false;
+
+		depth_.store(depth_view_);
+	}
 	
+	// Fires on any change at the top, price or size
 	void notify_if_best_changed()
 	{
-		Price current_bid = bids_.get_best_price();
-		Price current_ask = asks_.get_best_price();
+		const Price current_bid = bids_.get_best_price();
+		const Price current_ask = asks_.get_best_price();
+		const Qty current_bid_qty = bids_.get_best_qty();
+		const Qty current_ask_qty = asks_.get_best_qty();
 
-		if(current_bid != last_best_bid_ || current_ask != last_best_ask_)
+		const bool price_changed = current_bid != last_best_bid_ || current_ask != last_best_ask_;
+		if(!price_changed && current_bid_qty == last_best_bid_qty_ && current_ask_qty == last_best_ask_qty_) return;
+
+		if(price_changed) recenter_if_drifted(current_bid, current_ask);
+
+		uint64_t ts = get_timestamp_ns();
+		TopOfBook update{
+			.best_bid = current_bid,
+			.best_ask = current_ask,
+			.best_bid_qty = current_bid_qty,
+			.best_ask_qty = current_ask_qty,
+			.spread = get_spread(),
+			.recv_timestamp_ns = ts,
+			.update_timestamp_ns = ts
+		};
+
+		listeners_.on_book_update(update);
+
+		last_best_bid_ = current_bid;
+		last_best_ask_ = current_ask;
+		last_best_bid_qty_ = current_bid_qty;
+		last_best_ask_qty_ = current_ask_qty;
+	}
+
+	// Rests an order that has nothing (left) to match
+	AddResult rest(uint64_t order_id, Price price, Qty qty, Side side) noexcept
+	{
+		Order* order = pool_.allocate();
+		if(!order)
+		{
+			publish_updates();
+			return AddResult::PoolExhausted;
+		}
+
+		order->order_id = order_id;
+		order->quantity = qty;
+		order->side = side;
+
+		const bool rested = (side == Side::BID)
+			? bids_.add_order(order, price)
+			: asks_.add_order(order, price);
+
+		if(!rested)
 		{
-			uint64_t ts = get_timestamp_ns();
-			TopOfBook update{
-				.best_bid = current_bid,
-				.best_ask = current_ask,
-				.recv_timestamp_ns = ts,
-				.update_timestamp_ns = ts
+			pool_.deallocate(order);
+			publish_updates();
+			return AddResult::InvalidPrice;
+		}
+
+		order_map_.insert(order_id, order);
+		emit_order(DeltaType::OrderAdd, order, price, qty);
+		emit_level(side, price, true);
+		touch(side, price);
+		publish_updates();
+		return AddResult::Rested;
+	}
+
+	// Match selects add_order/replace_order (true) or their rest-only feed
+	// counterparts (false). True if the event was an add the book rejected.
+	template <bool Match>
+	bool apply(const MarketEvent& ev) noexcept
+	{
+		switch(ev.type)
+		{
+		case EventType::Add:
+		{
+			const AddResult r = Match
+				? add_order(ev.order_id, ev.price, ev.qty, ev.side)
+				: rest_order(ev.order_id, ev.price, ev.qty, ev.side);
+			return r == AddResult::InvalidPrice || r == AddResult::PoolExhausted;
+		}
+		case EventType::Cancel:
+			cancel_order(ev.order_id);
+			break;
+		case EventType::Modify:
+			modify_order(ev.order_id, ev.qty);
+			break;
+		case EventType::Trade:
+			execute_order(ev.order_id, ev.qty);
+			break;
+		case EventType::Reduce:
+			reduce_order(ev.order_id, ev.qty);
+			break;
+		case EventType::Replace:
+			if constexpr (Match) replace_order(ev.order_id, ev.price, ev.qty, ev.new_order_id);
+			else rest_replace_order(ev.order_id, ev.price, ev.qty, ev.new_order_id);
+			break;
+		}
+		return false;
+	}
+
+	template <bool Match>
+	size_t apply_all(std::span<const MarketEvent> events) noexcept
+	{
+		const size_t n = events.size();
+		const size_t warm = std::min(n, PREFETCH_DISTANCE);
+		size_t rejected = 0;
+
+		for(size_t i=0; i<warm; i++) prefetch(events[i]);
+
+		for(size_t i=0; i<n; i++)
+		{
+			if(i + PREFETCH_DISTANCE < n) prefetch(events[i + PREFETCH_DISTANCE]);
+			rejected += apply<Match>(events[i]);
+		}
+		return rejected;
+	}
+
+	template <bool Match, typename Own, typename Opposite>
+	AddResult replace_on(Own& own, Opposite& opposite, Order* order, Price new_price, Qty new_qty, uint64_t new_order_id) noexcept
+	{
+		const uint64_t order_id = order->order_id;
+		const Side side = order->side;
+		const Price price = own.price_of(*order);
+		const bool rekey = new_order_id != 0 && new_order_id != order_id;
+
+		if(!own.on_grid(new_price)) return AddResult::InvalidPrice;
+		// re-keying onto a live id would orphan that order's index entry
+		if(rekey && order_map_.find(new_order_id)) return AddResult::DuplicateOrder;
+
+		if(new_qty == 0)
+		{
+			cancel_order(order_id);
+			return AddResult::Cancelled;
+		}
+
+		if(new_price == price && !rekey)
+		{
+			modify_order(order_id, new_qty);
+			return AddResult::Rested;
+		}
+
+		emit_order(DeltaType::OrderCancel, order, price, order->quantity);
+		own.remove_order(order);
+		emit_level(side, price);
+		touch(side, price);
+
+		if(rekey)
+		{
+			order_map_.erase(order_id);
+			order->order_id = new_order_id;
+			order_map_.insert(new_order_id, order);
+		}
+
+		Qty remaining = new_qty;
+		if constexpr (Match)
+		{
+			auto on_fill = [this, order, side](Order* maker, Qty fill_qty, Price fill_price) noexcept
+			{
+				handle_fill(maker, fill_qty, fill_price, order->order_id, side);
 			};
+			remaining = opposite.match(new_price, new_qty, on_fill);
+		}
+
+		if(remaining == 0)
+		{
+			order_map_.erase(order->order_id);
+			pool_.deallocate(order);
+			publish_updates();
+			return AddResult::Filled;
+		}
+
+		order->quantity = remaining;
+		own.add_order(order, new_price);
+		emit_order(DeltaType::OrderAdd, order, new_price, remaining);
+		emit_level(side, new_price, true);
+		touch(side, new_price);
+		publish_updates();
+		return AddResult::Rested;
+	}
+
+	Price price_of(const Order& order) const noexcept
+	{
+		return order.side == Side::BID ? bids_.price_of(order) : asks_.price_of(order);
+	}
+
+	// Unlinks a resting order and returns it to the pool
+	void remove_resting(Order* order, Price price) noexcept
+	{
+		const Side side = order->side;
+
+		if(side == Side::BID)
+		{
+			bids_.remove_order(order);
+		}
+		else
+		{
+			asks_.remove_order(order);
+		}
 
-			for(auto* listener : listeners_) listener->on_book_update(update);
+		order_map_.erase(order->order_id);
+		pool_.deallocate(order);
+		touch(side, price);
+	}
+
+	void resize_resting(Order* order, Price price, Qty new_qty) noexcept
+	{
+		if(order->side == Side::BID)
+		{
+			bids_.modify_order(order, new_qty);
+		}
+		else
+		{
+			asks_.modify_order(order, new_qty);
+		}
+
+		touch(order->side, price);
+	}
 
-			last_best_bid_ = current_bid;
-			last_best_ask_ = current_ask;
+	void emit(const BookDelta& delta) noexcept
+	{
+		listeners_.on_delta(delta);
+	}
+
+	void emit_order(DeltaType type, const Order* order, Price price, Qty qty) noexcept
+	{
+		if(!listeners_.wants_deltas()) return;
+
+		emit(BookDelta{
+			.seq = ++delta_seq_,
+			.order_id = order->order_id,
+			.price = price,
+			.qty = qty,
+			.order_count = 0,
+			.type = type,
+			.side = order->side
+		});
+	}
+
+	// Reports the level at `price` as it stands now. `added` is set when the
+	// change was an order joining the level, so a lone order means a new level.
+	void emit_level(Side side, Price price, bool added = false) noexcept
+	{
+		if(!listeners_.wants_deltas()) return;
+
+		const PriceLevel level = side == Side::BID ? bids_.get_level(price) : asks_.get_level(price);
+
+		DeltaType type = DeltaType::LevelUpdate;
+		if(level.order_count == 0) type = DeltaType::LevelDelete;
+		else if(added && level.order_count == 1) type = DeltaType::LevelAdd;
+
+		emit(BookDelta{
+			.seq = ++delta_seq_,
+			.order_id = 0,
+			.price = price,
+			.qty = level.total_qty,
+			.order_count = level.order_count,
+			.type = type,
+			.side = side
+		});
+	}
+
+	void prefetch(const MarketEvent& ev) const noexcept
+	{
+		if(ev.type != EventType::Add) order_map_.prefetch(ev.order_id);
+		if(ev.type != EventType::Add && ev.type != EventType::Replace) return;
+
+		if(ev.side == Side::BID) bids_.prefetch(ev.price);
+		else asks_.prefetch(ev.price);
+	}
+
+	// Keeps both ladder windows around the mid (or the one-sided best) so the
+	// active levels stay in the dense rings rather than the overflow maps.
+	void recenter_if_drifted(Price bid, Price ask) noexcept
+	{
+		Price centre = INVALID_PRICE;
+		if(bid != INVALID_PRICE && ask != INVALID_PRICE) centre = bid + (ask - bid) / 2;
+		else if(bid != INVALID_PRICE) centre = bid;
+		else if(ask != INVALID_PRICE) centre = ask;
+		if(centre == INVALID_PRICE) return;
+
+		if(!bids_.is_centered(centre)) bids_.recenter(centre);
+		if(!asks_.is_centered(centre)) asks_.recenter(centre);
+	}
+
+	// Filled makers are already unlinked from their level by BookSide::match
+	// (which has updated the level totals too), so they only need to leave the
+	// index and go back to the pool.
+	void handle_fill(Order* maker, Qty fill_qty, Price price, uint64_t taker_id, Side aggressor) noexcept
+	{
+		const Trade trade{
+			.maker_order_id = maker->order_id,
+			.taker_order_id = taker_id,
+			.price = price,
+			.qty = fill_qty,
+			.aggressor = aggressor
+		};
+
+		listeners_.on_trade(trade);
+		emit_order(DeltaType::OrderExec, maker, price, fill_qty);
+		emit_level(maker->side, price);
+		touch(maker->side, price);
+
+		if(maker->quantity == 0)
+		{
+			order_map_.erase(maker->order_id);
+			pool_.deallocate(maker);
 		}
 	}
 
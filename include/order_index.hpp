@@ -0,0 +1,128 @@
+#pragma once
+#include "types.hpp"
+#include "absl/container/flat_hash_map.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Order-id -> Order* lookup policies for OrderBook. A policy provides
+// find / insert / erase / prefetch; find returns nullptr for unknown ids.
+
+// General purpose: any id distribution, pays a hash probe per lookup and
+// rehashes as it grows.
+class HashOrderIndex
+{
+private:
+	absl::flat_hash_map<uint64_t, Order*> map_;
+
+public:
+	HashOrderIndex() = default;
+	explicit HashOrderIndex(size_t expected_orders) { map_.reserve(expected_orders); }
+
+	[[nodiscard]] Order* find(uint64_t order_id) const noexcept
+	{
+		auto it = map_.find(order_id);
+		return it == map_.end() ? nullptr : it->second;
+	}
+
+	void prefetch(uint64_t order_id) const noexcept { map_.prefetch(order_id); }
+
+	void insert(uint64_t order_id, Order* order) { map_[order_id] = order; }
+	void erase(uint64_t order_id) noexcept { map_.erase(order_id); }
+
+	[[nodiscard]] size_t size() const noexcept { return map_.size(); }
+};
+
+// For feeds with dense, increasing ids: slot = order_id - base in a paged
+// table covering [base, base + capacity). Pages are allocated on first use
+// and never rehash; ids outside the range fall back to a hash map.
+class DirectOrderIndex
+{
+private:
+	static constexpr size_t PAGE_BITS = 16;
+	static constexpr size_t PAGE_SIZE = size_t{1} << PAGE_BITS;
+	static constexpr size_t PAGE_MASK = PAGE_SIZE - 1;
+
+	uint64_t base_;
+	uint64_t capacity_;
+	std::vector<std::unique_ptr<Order*[]>> pages_;
+	HashOrderIndex fallback_;
+	size_t size_ = 0;
+
+public:
+	// prefault allocates every page up front instead of on first use
+	DirectOrderIndex(uint64_t base_id, uint64_t capacity, bool prefault = false)
+		: base_(base_id),
+		  capacity_((capacity + PAGE_MASK) & ~uint64_t{PAGE_MASK}),
+		  pages_(capacity_ >> PAGE_BITS)
+	{
+		if(prefault)
+		{
+			for(auto& page : pages_) page = std::make_unique<Order*[]>(PAGE_SIZE);
+		}
+	}
+
+	DirectOrderIndex() : DirectOrderIndex(0, uint64_t{1} << 24) {}
+
+	[[nodiscard]] Order* find(uint64_t order_id) const noexcept
+	{
+		const uint64_t slot = order_id - base_;
+		if(slot >= capacity_) [[unlikely]] return fallback_.find(order_id);
+
+		const auto& page = pages_[slot >> PAGE_BITS];
+		return page ? page[slot & PAGE_MASK] : nullptr;
+	}
+
+	void prefetch(uint64_t order_id) const noexcept
+	{
+		const uint64_t slot = order_id - base_;
+		if(slot >= capacity_) [[unlikely]]
+		{
+			fallback_.prefetch(order_id);
+			return;
+		}
+
+		const auto& page = pages_[slot >> PAGE_BITS];
+		if(page) __builtin_prefetch(&page[slot & PAGE_MASK]);
+	}
+
+	void insert(uint64_t order_id, Order* order)
+	{
+		const uint64_t slot = order_id - base_;
+		if(slot >= capacity_) [[unlikely]]
+		{
+			if(!fallback_.find(order_id)) size_++;
+			fallback_.insert(order_id, order);
+			return;
+		}
+
+		auto& page = pages_[slot >> PAGE_BITS];
+		if(!page) [[unlikely]] page = std::make_unique<Order*[]>(PAGE_SIZE);
+
+		Order*& entry = page[slot & PAGE_MASK];
+		if(!entry) size_++;
+		entry = order;
+	}
+
+	void erase(uint64_t order_id) noexcept
+	{
+		const uint64_t slot = order_id - base_;
+		if(slot >= capacity_) [[unlikely]]
+		{
+			if(fallback_.find(order_id)) size_--;
+			fallback_.erase(order_id);
+			return;
+		}
+
+		auto& page = pages_[slot >> PAGE_BITS];
+		if(!page) return;
+
+		Order*& entry = page[slot & PAGE_MASK];
+		if(entry) size_--;
+		entry = nullptr;
+	}
+
+	[[nodiscard]] size_t size() const noexcept { return size_; }
+};
@@ -0,0 +1,128 @@
+#pragma once
+#include "types.hpp"
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class IOrderBookListener
+{
+public:
+	virtual ~IOrderBookListener() = default;
+
+	virtual void on_book_update(const TopOfBook& update) = 0;
+	virtual void on_trade(const Trade&) {}
+	virtual void on_delta(const BookDelta&) {}
+};
+
+// Listener dispatch policies for OrderBook (see book_traits.hpp). The book
+// calls on_book_update / on_trade / on_delta on its policy, and asks
+// wants_deltas() before building a delta nobody would see.
+
+// Listeners registered at run time, one virtual call each per callback.
+class DynamicListeners
+{
+private:
+	std::vector<IOrderBookListener*> listeners_;
+
+public:
+	void add(IOrderBookListener* listener) { listeners_.push_back(listener); }
+
+	[[nodiscard]] bool wants_deltas() const noexcept { return !listeners_.empty(); }
+
+	void on_book_update(const TopOfBook& update)
+	{
+		for(auto* listener : listeners_) listener->on_book_update(update);
+	}
+
+	void on_trade(const Trade& trade)
+	{
+		for(auto* listener : listeners_) listener->on_trade(trade);
+	}
+
+	void on_delta(const BookDelta& delta)
+	{
+		for(auto* listener : listeners_) listener->on_delta(delta);
+	}
+};
+
+// Listeners fixed at compile time. Each sink is held by value and called
+// directly, so its callbacks inline into the book thread; no vector, no
+// indirect calls. A sink implements whichever of on_book_update, on_trade and
+// on_delta it cares about as ordinary members, and the rest are skipped at
+// compile time (with no on_delta sink the book never builds deltas). Adding
+// DynamicListeners to the pack keeps add() for run-time registration:
+//
+//     StaticListeners<RiskSink, DeltaPublisher<Ring>, DynamicListeners>
+template <typename... Sinks>
+class StaticListeners
+{
+private:
+	std::tuple<Sinks...> sinks_;
+
+	static constexpr bool HAS_DYNAMIC = (std::is_same_v<Sinks, DynamicListeners> || ...);
+
+	template <typename Sink>
+	static bool sink_wants_deltas(const Sink& sink) noexcept
+	{
+		if constexpr (requires { sink.wants_deltas(); }) return sink.wants_deltas();
+		else return requires(Sink& s, const BookDelta& d) { s.on_delta(d); };
+	}
+
+public:
+	StaticListeners() = default;
+
+	explicit StaticListeners(Sinks... sinks) requires (sizeof...(Sinks) > 0)
+		: sinks_(std::move(sinks)...) {}
+
+	void add(IOrderBookListener* listener) requires HAS_DYNAMIC
+	{
+		std::get<DynamicListeners>(sinks_).add(listener);
+	}
+
+	template <typename Sink>
+	[[nodiscard]] Sink& get() noexcept { return std::get<Sink>(sinks_); }
+
+	template <std::size_t I>
+	[[nodiscard]] auto& get() noexcept { return std::get<I>(sinks_); }
+
+	[[nodiscard]] bool wants_deltas() const noexcept
+	{
+		return std::apply([](const auto&... sink) { return (sink_wants_deltas(sink) || ... || false); }, sinks_);
+	}
+
+	void on_book_update(const TopOfBook& update)
+	{
+		std::apply([&](auto&... sink)
+		{
+			([&]
+			{
+				if constexpr (requires { sink.on_book_update(update); }) sink.on_book_update(update);
+			}(), ...);
+		}, sinks_);
+	}
+
+	void on_trade(const Trade& trade)
+	{
+		std::apply([&](auto&... sink)
+		{
+			([&]
+			{
+				if constexpr (requires { sink.on_trade(trade); }) sink.on_trade(trade);
+			}(), ...);
+		}, sinks_);
+	}
+
+	void on_delta(const BookDelta& delta)
+	{
+		std::apply([&](auto&... sink)
+		{
+			([&]
+			{
+				if constexpr (requires { sink.on_delta(delta); }) sink.on_delta(delta);
+			}(), ...);
+		}, sinks_);
+	}
+};
@@ -1,30 +1,142 @@
 #pragma once
 #include "market_data.hpp"
 #include "order_book.hpp"
+#include "seqlock.hpp"
+#include "wait_strategy.hpp"
+
+#include <cstdint>
+
+template <typename Book>
+inline TopOfBook make_top_of_book(const Book& book) noexcept {
+	const Price bid = book.best_bid();
+	const Price ask = book.best_ask();
+	return TopOfBook {
+		.best_bid = bid,
+		.best_ask = ask,
+		.best_bid_qty = book.best_bid_qty(),
+		.best_ask_qty = book.best_ask_qty(),
+		.spread = ask - bid,
+		.recv_timestamp_ns = 0,
+		.update_timestamp_ns = 0
+	};
+}
 
 template <typename spsc>
 class MarketDataPublisher {
 private:
 	spsc& queue;
+	uint64_t dropped_ = 0;
 
 public:
 	explicit MarketDataPublisher(spsc& q)
 		: queue(q) {}
 
-	void publish(const OrderBook& book) noexcept {
+	template <typename Book>
+	void publish(const Book& book) noexcept {
 		if(book.best_bid() != INVALID_PRICE && book.best_ask() != INVALID_PRICE) {
-			TopOfBook tob {
-				book.best_bid(),
-				book.best_ask(),
-				spread(book.best_bid(), book.best_ask())
-			};
-
-			queue.push(tob);
+			if(!queue.push(make_top_of_book(book))) dropped_++;
 		}
 	}
 
+	// updates lost because the queue was full
+	uint64_t dropped() const noexcept { return dropped_; }
+};
+
+// Incremental L2/L3 feed: forwards every BookDelta of the books it listens
+// to into a queue with bool push(const BookDelta&), e.g. spsc<BookDelta>.
+// A full queue drops the delta; consumers see the hole in the sequence
+// numbers and resync from a snapshot. Works as a StaticListeners sink too.
+template <typename Queue>
+class DeltaPublisher final : public IOrderBookListener {
 private:
-	inline Price spread(Price best_bid, Price best_ask) const noexcept {
-		return	best_ask - best_bid;
+	Queue& queue_;
+	uint64_t dropped_ = 0;
+
+public:
+	explicit DeltaPublisher(Queue& q)
+		: queue_(q) {}
+
+	void on_book_update(const TopOfBook&) override {}
+
+	void on_delta(const BookDelta& delta) override {
+		if(!queue_.push(delta)) dropped_++;
 	}
+
+	uint64_t dropped() const noexcept { return dropped_; }
+};
+
+// Conflating mode: the book thread overwrites a single seqlock-protected slot
+// and never waits on readers. Each reader keeps its own cursor into the
+// version sequence, so it always gets the freshest BBO and learns how many
+// updates were conflated away since its last read. Wait is what readers do
+// in TopOfBookReader::wait() until a new BBO lands, see wait_strategy.hpp.
+template <typename Wait = BusySpin>
+class ConflatingMarketDataPublisher {
+private:
+	Seqlock<TopOfBook> latest_;
+	TopOfBook last_{};
+	Wait wait_;
+
+public:
+	template <typename Book>
+	void publish(const Book& book) noexcept {
+		if(book.best_bid() == INVALID_PRICE || book.best_ask() == INVALID_PRICE) return;
+
+		const TopOfBook tob = make_top_of_book(book);
+		if(tob.best_bid == last_.best_bid && tob.best_ask == last_.best_ask &&
+			tob.best_bid_qty == last_.best_bid_qty && tob.best_ask_qty == last_.best_ask_qty) return;
+
+		last_ = tob;
+		latest_.store(tob);
+		wait_.notify();
+	}
+
+	// wakes readers in TopOfBookReader::wait(), e.g. after setting their stop flag
+	void notify() noexcept { wait_.notify(); }
+
+	const Seqlock<TopOfBook>& slot() const noexcept { return latest_; }
+	Wait& wait_strategy() noexcept { return wait_; }
+};
+
+// Per-thread view of a ConflatingMarketDataPublisher.
+template <typename Wait = BusySpin>
+class TopOfBookReader {
+private:
+	const Seqlock<TopOfBook>& slot_;
+	Wait& wait_;
+	uint64_t last_seq_ = 0;
+	uint64_t skipped_ = 0;
+
+public:
+	explicit TopOfBookReader(ConflatingMarketDataPublisher<Wait>& publisher)
+		: slot_(publisher.slot()), wait_(publisher.wait_strategy()) {}
+
+	// true if a newer BBO than the last one read is available; `gap` receives
+	// the number of intermediate updates that were overwritten
+	bool poll(TopOfBook& out, uint64_t& gap) noexcept {
+		if(slot_.version() == last_seq_) return false;
+
+		const uint64_t seq = slot_.load(out);
+		if(seq == last_seq_) return false;
+
+		gap = seq - last_seq_ - 1;
+		skipped_ += gap;
+		last_seq_ = seq;
+		return true;
+	}
+
+	// poll() that idles on the wait strategy until a newer BBO arrives. False
+	// only once stop() holds and nothing newer is left; whoever makes stop()
+	// true must call the publisher's notify() afterwards.
+	template <typename Stop>
+	bool wait(TopOfBook& out, uint64_t& gap, Stop&& stop) noexcept {
+		while(!poll(out, gap)) {
+			if(stop()) return poll(out, gap);
+			wait_.wait([&]() { return slot_.version() != last_seq_ || stop(); });
+		}
+		return true;
+	}
+
+	uint64_t last_seq() const noexcept { return last_seq_; }
+	uint64_t skipped() const noexcept { return skipped_; }
 };
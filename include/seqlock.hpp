@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer, many-reader latest-value slot. The writer never waits;
+// readers retry while a store is in progress. The payload is kept in relaxed
+// atomic words so torn reads are detected by the sequence check rather than
+// being a data race.
+template <typename T>
+class Seqlock
+{
+private:
+	static_assert(std::is_trivially_copyable_v<T>, "seqlock payload must be trivially copyable");
+
+	static constexpr std::size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	alignas(64) std::atomic<uint64_t> seq_{0}; // odd while a store is in progress
+	std::atomic<uint64_t> data_[WORDS]{};
+
+public:
+	// Writer side. Returns the version of the stored value (1 for the first store).
+	uint64_t store(const T& value) noexcept
+	{
+		uint64_t words[WORDS]{};
+		std::memcpy(words, &value, sizeof(T));
+
+		const uint64_t seq = seq_.load(std::memory_order_relaxed);
+		seq_.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for(std::size_t i=0; i<WORDS; i++) data_[i].store(words[i], std::memory_order_relaxed);
+
+		seq_.store(seq + 2, std::memory_order_release);
+		return (seq + 2) / 2;
+	}
+
+	// Reader side. Copies a consistent value into `out` and returns its version;
+	// 0 means nothing has been stored yet (`out` is left untouched).
+	uint64_t load(T& out) const noexcept
+	{
+		uint64_t words[WORDS];
+		uint64_t before;
+		uint64_t after;
+
+		do
+		{
+			before = seq_.load(std::memory_order_acquire);
+			while(before & 1)
+			{
+				before = seq_.load(std::memory_order_acquire);
+			}
+
+			for(std::size_t i=0; i<WORDS; i++) words[i] = data_[i].load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = seq_.load(std::memory_order_relaxed);
+		} while(before != after);
+
+		if(before == 0) return 0;
+
+		std::memcpy(&out, words, sizeof(T));
+		return before / 2;
+	}
+
+	// version of the latest completed store, without reading the payload
+	[[nodiscard]] uint64_t version() const noexcept
+	{
+		return seq_.load(std::memory_order_acquire) / 2;
+	}
+};
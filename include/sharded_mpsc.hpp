@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "spsc.hpp"
+#include "wait_strategy.hpp"
+
+// Many producers, one consumer, without a shared index: producer i owns SPSC
+// lane i, and the consumer merges the lanes in turn. Each producer's items
+// come out in the order it pushed them; there is no order across producers.
+// Producers never touch each other's cache lines, so adding one costs the
+// others nothing, unlike mpmc where every push contends on tail_.
+//
+// Producer ids are fixed up front (0 .. producers-1) and each must be used
+// by one thread only. Wait is what pop_wait() does while every lane is
+// empty, see wait_strategy.hpp.
+template <typename T, typename Wait = BusySpin>
+class sharded_mpsc {
+private:
+	using Lane = spsc<T>;
+
+	std::vector<std::unique_ptr<Lane>> lanes_;
+	std::size_t cursor_ = 0; // consumer: lane to try first
+
+	[[no_unique_address]] Wait wait_;
+
+public:
+	sharded_mpsc(std::size_t producers, std::size_t lane_size_pow2) {
+		if(producers == 0) {
+			throw std::invalid_argument("need at least one producer lane");
+		}
+
+		lanes_.reserve(producers);
+		for(std::size_t i=0; i<producers; i++) {
+			lanes_.push_back(std::make_unique<Lane>(lane_size_pow2));
+		}
+	}
+
+	// Non-copyable, non-movable
+	sharded_mpsc(const sharded_mpsc&) = delete;
+	sharded_mpsc& operator=(const sharded_mpsc&) = delete;
+
+	// producer side; false if the producer's lane is full
+	bool push(std::size_t producer, const T& value) noexcept {
+		if(!lanes_[producer]->push(value)) return false;
+		wait_.notify();
+		return true;
+	}
+
+	std::size_t push_n(std::size_t producer, const T* items, std::size_t n) noexcept {
+		const std::size_t count = lanes_[producer]->push_n(items, n);
+		if(count) wait_.notify();
+		return count;
+	}
+
+	// Takes one item, visiting the lanes round-robin so a busy producer cannot
+	// starve the others.
+	bool pop(T& out) noexcept {
+		const std::size_t lanes = lanes_.size();
+		for(std::size_t i=0; i<lanes; i++) {
+			const std::size_t lane = cursor_;
+			cursor_ = cursor_ + 1 == lanes ? 0 : cursor_ + 1;
+			if(lanes_[lane]->pop(out)) return true;
+		}
+		return false;
+	}
+
+	// Drains up to n items, a batch from each lane in turn.
+	std::size_t pop_n(T* out, std::size_t n) noexcept {
+		const std::size_t lanes = lanes_.size();
+		std::size_t count = 0;
+		for(std::size_t i=0; i<lanes && count < n; i++) {
+			count += lanes_[cursor_]->pop_n(out + count, n - count);
+			cursor_ = cursor_ + 1 == lanes ? 0 : cursor_ + 1;
+		}
+		return count;
+	}
+
+	// Pops, idling on the wait strategy while every lane is empty. Returns
+	// false only once stop() holds and the lanes are drained; whoever makes
+	// stop() true must call notify() afterwards.
+	template <typename Stop>
+	bool pop_wait(T& out, Stop&& stop) noexcept {
+		while(!pop(out)) {
+			if(stop()) return pop(out);
+			wait_.wait([&]() { return !empty() || stop(); });
+		}
+		return true;
+	}
+
+	void notify() noexcept { wait_.notify(); }
+
+	bool empty() const noexcept {
+		for(const auto& lane : lanes_) {
+			if(!lane->empty()) return false;
+		}
+		return true;
+	}
+
+	std::size_t producers() const noexcept { return lanes_.size(); }
+};
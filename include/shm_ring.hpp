@@ -0,0 +1,402 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Rings that live in a POSIX shared-memory segment so the book process can
+// feed consumers in other processes. Nothing inside the segment is a pointer:
+// each process maps it wherever it likes and finds the slots through the
+// offset in the header.
+
+// Owns one mapping of a named segment. The creator unlinks it on destruction.
+class ShmSegment {
+private:
+	std::string name_;
+	void* base_ = nullptr;
+	std::size_t size_ = 0;
+	bool owner_ = false;
+
+	ShmSegment(std::string name, void* base, std::size_t size, bool owner)
+	: name_(std::move(name)), base_(base), size_(size), owner_(owner) {}
+
+public:
+	// Replaces any stale segment of the same name.
+	static ShmSegment create(const std::string& name, std::size_t bytes) {
+		::shm_unlink(name.c_str());
+
+		const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+		if(fd < 0) throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+
+		if(::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+			const int err = errno;
+			::close(fd);
+			::shm_unlink(name.c_str());
+			throw std::system_error(err, std::generic_category(), "ftruncate " + name);
+		}
+
+		void* base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+		const int err = errno;
+		::close(fd);
+		if(base == MAP_FAILED) {
+			::shm_unlink(name.c_str());
+			throw std::system_error(err, std::generic_category(), "mmap " + name);
+		}
+		return ShmSegment(name, base, bytes, true);
+	}
+
+	// Waits up to `timeout` for the segment to appear and be sized by its creator.
+	static ShmSegment open(const std::string& name, bool writable,
+						   std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+		const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+		while(true) {
+			const int fd = ::shm_open(name.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+			if(fd >= 0) {
+				struct stat st{};
+				if(::fstat(fd, &st) == 0 && st.st_size > 0) {
+					const std::size_t bytes = static_cast<std::size_t>(st.st_size);
+					const int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+					void* base = ::mmap(nullptr, bytes, prot, MAP_SHARED, fd, 0);
+					const int err = errno;
+					::close(fd);
+					if(base == MAP_FAILED) throw std::system_error(err, std::generic_category(), "mmap " + name);
+					return ShmSegment(name, base, bytes, false);
+				}
+				::close(fd);
+			} else if(errno != ENOENT) {
+				throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+			}
+
+			if(std::chrono::steady_clock::now() >= deadline) {
+				throw std::runtime_error("timed out waiting for shared memory segment " + name);
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	ShmSegment(ShmSegment&& other) noexcept
+	: name_(std::move(other.name_)), base_(other.base_), size_(other.size_), owner_(other.owner_) {
+		other.base_ = nullptr;
+		other.owner_ = false;
+	}
+
+	ShmSegment& operator=(ShmSegment&&) = delete;
+	ShmSegment(const ShmSegment&) = delete;
+	ShmSegment& operator=(const ShmSegment&) = delete;
+
+	~ShmSegment() {
+		if(base_) ::munmap(base_, size_);
+		if(owner_) ::shm_unlink(name_.c_str());
+	}
+
+	void* base() const noexcept { return base_; }
+	std::size_t size() const noexcept { return size_; }
+	const std::string& name() const noexcept { return name_; }
+};
+
+// First bytes of every ring segment. The creator fills it in and sets
+// `ready` last; openers wait for `ready` and then reject segments written by
+// a build with a different layout.
+struct ShmRingHeader {
+	static constexpr uint64_t MAGIC = 0x474e'5252'4d48'5342; // "BSHMRRNG"
+	static constexpr uint32_t VERSION = 1;
+
+	enum Kind : uint32_t {
+		SPSC = 1,
+		BROADCAST = 2
+	};
+
+	uint64_t magic;
+	uint32_t version;
+	uint32_t kind;
+	uint64_t element_size;
+	uint64_t slot_size;
+	uint64_t capacity;
+	uint64_t slots_offset; // from the segment base
+	std::atomic<uint32_t> ready;
+};
+
+namespace shm_detail {
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory rings need address-free 64-bit atomics");
+
+constexpr std::size_t align_up(std::size_t n, std::size_t a) noexcept { return (n + a - 1) & ~(a - 1); }
+
+inline void check_capacity(std::size_t capacity) {
+	if(capacity == 0 || (capacity & (capacity - 1)) != 0) {
+		throw std::invalid_argument("size must be a power of two");
+	}
+}
+
+template <typename Control>
+Control* init_control(ShmSegment& seg, ShmRingHeader::Kind kind, std::size_t element_size,
+					  std::size_t slot_size, std::size_t capacity) {
+	Control* ctl = new (seg.base()) Control();
+	ShmRingHeader& h = ctl->header;
+	h.magic = ShmRingHeader::MAGIC;
+	h.version = ShmRingHeader::VERSION;
+	h.kind = kind;
+	h.element_size = element_size;
+	h.slot_size = slot_size;
+	h.capacity = capacity;
+	h.slots_offset = align_up(sizeof(Control), 64);
+	h.ready.store(1, std::memory_order_release);
+	return ctl;
+}
+
+template <typename Control>
+const Control* attach_control(const ShmSegment& seg, ShmRingHeader::Kind kind, std::size_t element_size,
+							  std::size_t slot_size, std::chrono::milliseconds timeout) {
+	if(seg.size() < sizeof(Control)) throw std::runtime_error("shared memory segment too small: " + seg.name());
+
+	const Control* ctl = static_cast<const Control*>(seg.base());
+	const ShmRingHeader& h = ctl->header;
+
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	while(h.ready.load(std::memory_order_acquire) == 0) {
+		if(std::chrono::steady_clock::now() >= deadline) {
+			throw std::runtime_error("shared memory ring never became ready: " + seg.name());
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	if(h.magic != ShmRingHeader::MAGIC || h.version != ShmRingHeader::VERSION || h.kind != kind ||
+	   h.element_size != element_size || h.slot_size != slot_size) {
+		throw std::runtime_error("shared memory ring layout mismatch: " + seg.name());
+	}
+	if(h.slots_offset + h.capacity * slot_size > seg.size()) {
+		throw std::runtime_error("shared memory ring truncated: " + seg.name());
+	}
+	return ctl;
+}
+
+template <typename T>
+struct BroadcastSlot {
+	static constexpr std::size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	// 2 * (msg + 1) once message `msg` is complete, odd while it is written
+	std::atomic<uint64_t> seq{0};
+	std::atomic<uint64_t> data[WORDS]{};
+};
+
+template <typename T>
+struct BroadcastControl {
+	ShmRingHeader header;
+	alignas(64) std::atomic<uint64_t> published{0}; // messages written so far
+};
+
+} // namespace shm_detail
+
+// spsc with its indices and slots in shared memory; the producer and consumer
+// may be different processes. Each side keeps its cached copy of the other
+// side's index in its own process.
+template <typename T>
+class ShmSpscRing {
+private:
+	static_assert(std::is_trivially_copyable_v<T>, "shared-memory payload must be trivially copyable");
+
+	struct Control {
+		ShmRingHeader header;
+		alignas(64) std::atomic<uint64_t> head{0}; // read
+		alignas(64) std::atomic<uint64_t> tail{0}; // write
+	};
+
+	ShmSegment seg_;
+	Control* ctl_;
+	T* slots_;
+	uint64_t mask_;
+	uint64_t cached_head_ = 0;
+	uint64_t cached_tail_ = 0;
+
+	ShmSpscRing(ShmSegment seg, Control* ctl)
+	: seg_(std::move(seg)),
+	  ctl_(ctl),
+	  slots_(reinterpret_cast<T*>(static_cast<char*>(seg_.base()) + ctl->header.slots_offset)),
+	  mask_(ctl->header.capacity - 1) {}
+
+public:
+	static ShmSpscRing create(const std::string& name, std::size_t size_pow2) {
+		shm_detail::check_capacity(size_pow2);
+		const std::size_t bytes = shm_detail::align_up(sizeof(Control), 64) + size_pow2 * sizeof(T);
+		ShmSegment seg = ShmSegment::create(name, bytes);
+		Control* ctl = shm_detail::init_control<Control>(seg, ShmRingHeader::SPSC, sizeof(T), sizeof(T), size_pow2);
+		return ShmSpscRing(std::move(seg), ctl);
+	}
+
+	static ShmSpscRing open(const std::string& name,
+							std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+		ShmSegment seg = ShmSegment::open(name, true, timeout);
+		const Control* ctl = shm_detail::attach_control<Control>(seg, ShmRingHeader::SPSC, sizeof(T), sizeof(T), timeout);
+		return ShmSpscRing(std::move(seg), const_cast<Control*>(ctl));
+	}
+
+	ShmSpscRing(ShmSpscRing&&) = default;
+
+	bool push(const T& value) noexcept {
+		const auto tail = ctl_->tail.load(std::memory_order_relaxed);
+		if(tail - cached_head_ >= mask_) {
+			cached_head_ = ctl_->head.load(std::memory_order_acquire);
+			if(tail - cached_head_ >= mask_) {
+				return false;
+			}
+		}
+
+		std::memcpy(&slots_[tail & mask_], &value, sizeof(T));
+		ctl_->tail.store(tail+1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T& out) noexcept {
+		const auto head = ctl_->head.load(std::memory_order_relaxed);
+		if(head == cached_tail_) {
+			cached_tail_ = ctl_->tail.load(std::memory_order_acquire);
+			if(head == cached_tail_) {
+				return false;
+			}
+		}
+
+		std::memcpy(&out, &slots_[head & mask_], sizeof(T));
+		ctl_->head.store(head+1, std::memory_order_release);
+		return true;
+	}
+
+	bool empty() const noexcept {
+		return ctl_->head.load(std::memory_order_acquire) == ctl_->tail.load(std::memory_order_acquire);
+	}
+
+	std::size_t capacity() const noexcept { return mask_; }
+};
+
+// Multicast-style bus: one writer, any number of readers in any processes.
+// The writer never waits; it overwrites the oldest slot. Every slot carries
+// the sequence it holds under a per-slot seqlock, so a reader that falls a
+// full ring behind notices, skips ahead and is told how many messages it
+// lost. Readers map the segment read-only and keep their cursor to
+// themselves, so a stuck or crashed reader cannot affect anyone else.
+template <typename T>
+class ShmBroadcastWriter {
+private:
+	static_assert(std::is_trivially_copyable_v<T>, "shared-memory payload must be trivially copyable");
+
+	using Slot = shm_detail::BroadcastSlot<T>;
+	using Control = shm_detail::BroadcastControl<T>;
+
+	ShmSegment seg_;
+	Control* ctl_;
+	Slot* slots_;
+	uint64_t mask_;
+	uint64_t next_ = 0;
+
+public:
+	ShmBroadcastWriter(const std::string& name, std::size_t size_pow2)
+	: seg_(make_segment(name, size_pow2)),
+	  ctl_(nullptr),
+	  slots_(nullptr),
+	  mask_(size_pow2 - 1) {
+		char* base = static_cast<char*>(seg_.base());
+		// slots first, so readers that see `ready` also see initialised slots
+		slots_ = reinterpret_cast<Slot*>(base + shm_detail::align_up(sizeof(Control), 64));
+		for(std::size_t i=0; i<size_pow2; i++) new (&slots_[i]) Slot();
+		ctl_ = shm_detail::init_control<Control>(seg_, ShmRingHeader::BROADCAST, sizeof(T), sizeof(Slot), size_pow2);
+	}
+
+	// Always succeeds; the bool keeps it a drop-in queue for the publishers.
+	bool push(const T& value) noexcept {
+		uint64_t words[Slot::WORDS]{};
+		std::memcpy(words, &value, sizeof(T));
+
+		Slot& slot = slots_[next_ & mask_];
+		slot.seq.store(2 * next_ + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for(std::size_t i=0; i<Slot::WORDS; i++) slot.data[i].store(words[i], std::memory_order_relaxed);
+
+		slot.seq.store(2 * (next_ + 1), std::memory_order_release);
+		ctl_->published.store(++next_, std::memory_order_release);
+		return true;
+	}
+
+	uint64_t published() const noexcept { return next_; }
+	std::size_t capacity() const noexcept { return mask_ + 1; }
+
+private:
+	static ShmSegment make_segment(const std::string& name, std::size_t size_pow2) {
+		shm_detail::check_capacity(size_pow2);
+		return ShmSegment::create(name, shm_detail::align_up(sizeof(Control), 64) + size_pow2 * sizeof(Slot));
+	}
+};
+
+template <typename T>
+class ShmBroadcastReader {
+private:
+	using Slot = shm_detail::BroadcastSlot<T>;
+	using Control = shm_detail::BroadcastControl<T>;
+
+	ShmSegment seg_;
+	const Control* ctl_;
+	const Slot* slots_;
+	uint64_t capacity_;
+	uint64_t next_;
+	uint64_t lost_ = 0;
+
+public:
+	// Starts at the live edge, or at the oldest message still in the ring.
+	explicit ShmBroadcastReader(const std::string& name, bool from_oldest = false,
+								std::chrono::milliseconds timeout = std::chrono::milliseconds(5000))
+	: seg_(ShmSegment::open(name, false, timeout)),
+	  ctl_(shm_detail::attach_control<Control>(seg_, ShmRingHeader::BROADCAST, sizeof(T), sizeof(Slot), timeout)),
+	  slots_(reinterpret_cast<const Slot*>(static_cast<const char*>(seg_.base()) + ctl_->header.slots_offset)),
+	  capacity_(ctl_->header.capacity) {
+		const uint64_t published = ctl_->published.load(std::memory_order_acquire);
+		next_ = (from_oldest && published > capacity_) ? published - capacity_ : (from_oldest ? 0 : published);
+	}
+
+	// true with the next message in `out`; messages overwritten before this
+	// reader got to them are added to lost()
+	bool poll(T& out) noexcept {
+		while(true) {
+			const uint64_t published = ctl_->published.load(std::memory_order_acquire);
+			if(next_ == published) return false;
+
+			if(published - next_ > capacity_) {
+				lost_ += published - capacity_ - next_;
+				next_ = published - capacity_;
+			}
+
+			const Slot& slot = slots_[next_ & (capacity_ - 1)];
+			const uint64_t expected = 2 * (next_ + 1);
+
+			uint64_t words[Slot::WORDS];
+			const uint64_t before = slot.seq.load(std::memory_order_acquire);
+			if(before != expected) continue; // lapped while we looked
+
+			for(std::size_t i=0; i<Slot::WORDS; i++) words[i] = slot.data[i].load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if(slot.seq.load(std::memory_order_relaxed) != expected) continue;
+
+			std::memcpy(&out, words, sizeof(T));
+			next_++;
+			return true;
+		}
+	}
+
+	// sequence number of the next message this reader will return
+	uint64_t position() const noexcept { return next_; }
+	uint64_t lost() const noexcept { return lost_; }
+};
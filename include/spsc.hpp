@@ -1,3 +1,5 @@
+#pragma once
+
 #include <atomic>
 #include <stdexcept>
 #include <memory>
@@ -5,7 +7,10 @@
 #include <cstddef>
 #include <cstdint>
 
-template <typename T, typename Alloc = std::allocator<T>>
+#include "wait_strategy.hpp"
+
+// Wait is what pop_wait() does while the ring is empty, see wait_strategy.hpp.
+template <typename T, typename Alloc = std::allocator<T>, typename Wait = BusySpin>
 class spsc {
 private:
 	using allocator_traits = std::allocator_traits<Alloc>;
@@ -14,11 +19,18 @@ private:
 	const std::size_t size_;
 	const std::size_t mask_;
 
+	// Each side keeps a private copy of the other side's index next to its own
+	// and only reloads the shared one when the ring looks full (producer) or
+	// empty (consumer), so steady-state traffic does not bounce both lines.
 	alignas(64) std::atomic<uint64_t> head_{0}; // read
-	char pad1[64 - sizeof(std::atomic<uint64_t>)];	
+	uint64_t cached_tail_ = 0; // consumer's last view of tail_
+	char pad1[64 - sizeof(std::atomic<uint64_t>) - sizeof(uint64_t)];
 
 	alignas(64) std::atomic<uint64_t> tail_{0}; // write
-	char pad2[64 - sizeof(std::atomic<uint64_t>)];	
+	uint64_t cached_head_ = 0; // producer's last view of head_
+	char pad2[64 - sizeof(std::atomic<uint64_t>) - sizeof(uint64_t)];
+
+	[[no_unique_address]] Wait wait_;
 
 public:
 	explicit spsc(size_t size_pow2, const Alloc& alloc = Alloc())
@@ -51,10 +63,11 @@ public:
 
 	bool pop(T& out) noexcept {
 		const auto head = head_.load(std::memory_order_relaxed);
-		const auto tail = tail_.load(std::memory_order_acquire);
-
-		if(head == tail) {
-			return false;
+		if(head == cached_tail_) {
+			cached_tail_ = tail_.load(std::memory_order_acquire);
+			if(head == cached_tail_) {
+				return false;
+			}
 		}
 
 		out = buffer_[head & mask_];
@@ -63,6 +76,80 @@ public:
 		return true;
 	}
 
+	// Pops, idling on the wait strategy while the ring is empty. Returns false
+	// only once stop() holds and the ring is drained; whoever makes stop()
+	// true must call notify() afterwards.
+	template <typename Stop>
+	bool pop_wait(T& out, Stop&& stop) noexcept {
+		while(!pop(out)) {
+			if(stop()) return pop(out);
+			wait_.wait([&]() { return !empty() || stop(); });
+		}
+		return true;
+	}
+
+	// Wakes a consumer idling in pop_wait(). Pushes do this themselves.
+	void notify() noexcept { wait_.notify(); }
+
+	// Pushes up to n items with a single release of the tail index.
+	// Returns how many were pushed.
+	std::size_t push_n(const T* items, std::size_t n) noexcept {
+		const auto tail = tail_.load(std::memory_order_relaxed);
+		std::size_t space = mask_ - (tail - cached_head_);
+		if(space < n) {
+			cached_head_ = head_.load(std::memory_order_acquire);
+			space = mask_ - (tail - cached_head_);
+		}
+
+		const std::size_t count = n < space ? n : space;
+		for(std::size_t i=0; i<count; i++) {
+			buffer_[(tail + i) & mask_] = items[i];
+		}
+
+		if(count) {
+			tail_.store(tail+count, std::memory_order_release);
+			wait_.notify();
+		}
+		return count;
+	}
+
+	// Pops up to n items with a single release of the head index.
+	// Returns how many were popped.
+	std::size_t pop_n(T* out, std::size_t n) noexcept {
+		const auto head = head_.load(std::memory_order_relaxed);
+		std::size_t ready = cached_tail_ - head;
+		if(ready < n) {
+			cached_tail_ = tail_.load(std::memory_order_acquire);
+			ready = cached_tail_ - head;
+		}
+
+		const std::size_t count = n < ready ? n : ready;
+		for(std::size_t i=0; i<count; i++) {
+			out[i] = buffer_[(head + i) & mask_];
+		}
+
+		if(count) head_.store(head+count, std::memory_order_release);
+		return count;
+	}
+
+	// Zero-copy read: the oldest element in place, or nullptr if empty. It
+	// stays valid until consume() releases it back to the producer.
+	const T* front() noexcept {
+		const auto head = head_.load(std::memory_order_relaxed);
+		if(head == cached_tail_) {
+			cached_tail_ = tail_.load(std::memory_order_acquire);
+			if(head == cached_tail_) {
+				return nullptr;
+			}
+		}
+		return &buffer_[head & mask_];
+	}
+
+	// Releases the element returned by front().
+	void consume() noexcept {
+		head_.store(head_.load(std::memory_order_relaxed)+1, std::memory_order_release);
+	}
+
 	bool empty() const noexcept {
 		return head_.load(std::memory_order_acquire) ==
 			tail_.load(std::memory_order_acquire);
@@ -81,15 +168,17 @@ private:
 	template<typename... Args>
 	bool emplace(Args&&... args) noexcept {
 		const auto tail = tail_.load(std::memory_order_relaxed);
-		const auto head = head_.load(std::memory_order_acquire);
-
-		if(((tail+1) & mask_) == (head & mask_)) {
-			return false;
+		if(tail - cached_head_ >= mask_) {
+			cached_head_ = head_.load(std::memory_order_acquire);
+			if(tail - cached_head_ >= mask_) {
+				return false;
+			}
 		}
 
 		new (&buffer_[tail & mask_]) T(std::forward<Args>(args)...); 
 
 		tail_.store(tail+1, std::memory_order_release);
+		wait_.notify();
 		return true;
 	}
 
@@ -1,4 +1,6 @@
 #pragma once
+#include <array>
+#include <cstddef>
 #include <cstdint>
 
 using Price = uint32_t;
@@ -8,28 +10,48 @@ constexpr Price INVALID_PRICE = static_cast<Price>(-1);
 
 constexpr std::size_t MAX_PRICE_LEVELS = 1 << 17;
 
-enum class Side 
+enum class Side : uint8_t
 {
     BID,
     ASK
 };
 
+enum class AddResult : uint8_t
+{
+    Rested,         // remainder (or all of it) rests on the book
+    Filled,         // fully filled on entry, nothing rests
+    InvalidPrice,   // price off the tick grid
+    PoolExhausted,  // order pool could not supply an Order
+    UnknownOrder,   // replace of an order id that is not on the book
+    DuplicateOrder, // replace re-keyed to an id already on the book
+    Cancelled       // replace to a zero quantity removed the order
+};
+
+// Pool index standing in for a null Order link
+constexpr uint32_t NULL_ORDER = static_cast<uint32_t>(-1);
+
+// Orders link to each other by 32-bit OrderPool index rather than pointer,
+// which leaves room to keep the order's own tick and index in 32 bytes, two
+// orders per cache line. OrderPool::at() turns an index into an Order*.
 struct Order 
 {
     uint64_t order_id;
     Qty quantity;
+    uint32_t tick;   // level the order rests at, on its BookSide's grid
+    uint32_t next;   // toward the back of the level (also the pool free list)
+    uint32_t prev;   // toward the front of the level
+    uint32_t index;  // this order's own pool index, fixed for the pool's life
     Side side;
-
-    Order* next;
-    Order* prev;
 };
 
+static_assert(sizeof(Order) == 32);
+
 struct PriceLevel
 {
-	Qty total_qty = 0;
+    Qty total_qty = 0;
     uint32_t order_count = 0;
-    Order* head = nullptr;
-    Order* tail = nullptr;
+    uint32_t head = NULL_ORDER;
+    uint32_t tail = NULL_ORDER;
 };
 
 struct TopOfBook
@@ -43,6 +65,43 @@ struct TopOfBook
     uint64_t update_timestamp_ns; // When orderbook was updated
 };
 
+struct Trade
+{
+    uint64_t maker_order_id;  // resting order
+    uint64_t taker_order_id;  // aggressing order
+    Price price;              // maker's level price
+    Qty qty;
+    Side aggressor;
+};
+
+enum class DeltaType : uint8_t
+{
+    LevelAdd,     // level created: qty / order_count are its new totals
+    LevelUpdate,  // level changed: qty / order_count are its new totals
+    LevelDelete,  // level emptied
+    OrderAdd,     // order rested with qty
+    OrderCancel,  // order left the book, qty is what it had left
+    OrderModify,  // order resized at its price, qty is its new size; an
+                  // increase also sends it to the back of its level
+    OrderExec     // order executed against, qty is the executed size
+};
+
+// One incremental book change, fixed-size for binary transport. seq is per
+// book and increases by exactly one per delta, so consumers can detect gaps.
+// Each book change produces the order delta first, then the level delta.
+struct BookDelta
+{
+    uint64_t seq;
+    uint64_t order_id;     // 0 for level deltas
+    Price price;
+    Qty qty;
+    uint32_t order_count;  // level deltas only
+    DeltaType type;
+    Side side;
+};
+
+static_assert(sizeof(BookDelta) == 32);
+
 struct DepthLevel
 {
     Price price;
@@ -50,10 +109,34 @@ struct DepthLevel
     uint32_t order_count;
 };
 
-struct MarketDepth
+// Result of walking a quantity through one side of the book
+struct FillEstimate
 {
-    std::array<DepthLevel, 5> bids;
-    std::array<DepthLevel, 5> asks;
-    size_t bid_levels;  // levels actually populated and other indexes are empty/dummy
-    size_t ask_levels;
-};
\ No newline at end of file
+    uint64_t filled = 0;               // less than asked if the side ran out
+    uint64_t notional = 0;             // sum of price * qty over the fills
+    Price worst_price = INVALID_PRICE; // last level reached
+};
+
+// Top-N view of both sides, published by OrderBook for reader threads
+template <std::size_t N>
+struct DepthSnapshot
+{
+    std::array<DepthLevel, N> bids{};
+    std::array<DepthLevel, N> asks{};
+    size_t bid_levels = 0;  // levels actually populated, the rest are empty
+    size_t ask_levels = 0;
+};
+
+// Near-touch signals OrderBook keeps current as the book changes. Depth is
+// counted within a window of ticks from each best; weighted depth weighs the
+// levels within a second window linearly, from the window size at the best
+// down to 1. Imbalances are (bid - ask) / (bid + ask), 0 when both are empty.
+struct BookSignals
+{
+    double microprice = 0.0;         // size-weighted mid of the top level, 0 unless both sides are set
+    double depth_imbalance = 0.0;    // over bid_depth / ask_depth
+    double weighted_imbalance = 0.0; // over the weighted depths
+    int64_t pressure = 0;            // weighted bid depth - weighted ask depth, in lots
+    uint64_t bid_depth = 0;
+    uint64_t ask_depth = 0;
+};
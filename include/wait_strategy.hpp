@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <thread>
+#include <immintrin.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// What a consumer does while its queue is empty. A strategy provides
+//
+//   template <typename Ready> void wait(Ready&& ready)
+//       consumer side: returns once ready() holds
+//   void notify()
+//       producer side: called after every publish, and by whoever changes
+//       what ready() depends on (e.g. a stop flag)
+//
+// and lives inside the queue it serves, so each queue picks its own.
+
+// Burns the core; lowest wake-up latency. For hot symbols on dedicated cores.
+struct BusySpin {
+	template <typename Ready>
+	void wait(Ready&& ready) noexcept {
+		while(!ready()) _mm_pause();
+	}
+
+	void notify() noexcept {}
+};
+
+// Spins for a while, then hands the core to the scheduler between checks.
+// Still polls, but lets other threads share the core.
+template <uint32_t Spins = 1024>
+struct SpinYield {
+	template <typename Ready>
+	void wait(Ready&& ready) noexcept {
+		for(uint32_t i=0; i<Spins; i++) {
+			if(ready()) return;
+			_mm_pause();
+		}
+		while(!ready()) std::this_thread::yield();
+	}
+
+	void notify() noexcept {}
+};
+
+// Spins, yields, then sleeps on a futex until a producer wakes it. The
+// consumer flags itself as a waiter before its last check, so producers only
+// enter the kernel when someone is actually parked; the price on the
+// producer side is one full fence per notify(). Private futex: the queue must
+// not be shared between processes.
+template <uint32_t Spins = 1024, uint32_t Yields = 16>
+class SpinPark {
+private:
+	alignas(64) std::atomic<uint32_t> epoch_{0}; // futex word, bumped by every wake
+	std::atomic<uint32_t> waiters_{0};
+	char pad_[64 - 2 * sizeof(std::atomic<uint32_t>)];
+
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free);
+
+	uint32_t* futex_word() noexcept {
+		return reinterpret_cast<uint32_t*>(&epoch_);
+	}
+
+public:
+	template <typename Ready>
+	void wait(Ready&& ready) noexcept {
+		for(uint32_t i=0; i<Spins; i++) {
+			if(ready()) return;
+			_mm_pause();
+		}
+		for(uint32_t i=0; i<Yields; i++) {
+			if(ready()) return;
+			std::this_thread::yield();
+		}
+
+		while(true) {
+			const uint32_t epoch = epoch_.load(std::memory_order_acquire);
+			waiters_.fetch_add(1, std::memory_order_relaxed);
+			// pairs with the fence in notify(): either the producer sees the
+			// flag or this check sees what it published
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			const bool done = ready();
+			if(!done) ::syscall(SYS_futex, futex_word(), FUTEX_WAIT_PRIVATE, epoch, nullptr, nullptr, 0);
+			waiters_.fetch_sub(1, std::memory_order_relaxed);
+			if(done || ready()) return;
+		}
+	}
+
+	void notify() noexcept {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(waiters_.load(std::memory_order_relaxed) == 0) return;
+
+		epoch_.fetch_add(1, std::memory_order_release);
+		::syscall(SYS_futex, futex_word(), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+	}
+};
@@ -1,38 +1,91 @@
 #include "OrderPool.hpp"
 
-#include <stdlib.h>
+#include <bit>
+#include <sys/mman.h>
+
+namespace {
+
+size_t round_up(size_t n, size_t multiple)
+{
+    return (n + multiple - 1) / multiple * multiple;
+}
+
+// Returns nullptr on failure. With huge pages we first ask for explicit
+// hugetlbfs pages and fall back to transparent huge pages on a normal mapping.
+void* map_chunk(size_t bytes, bool huge_pages, bool prefault)
+{
+    constexpr int prot = PROT_READ | PROT_WRITE;
+    constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    const int populate = prefault ? MAP_POPULATE : 0;
+
+    void* mem = MAP_FAILED;
+    if(huge_pages)
+    {
+        mem = mmap(nullptr, bytes, prot, flags | MAP_HUGETLB | populate, -1, 0);
+    }
+    if(mem == MAP_FAILED)
+    {
+        mem = mmap(nullptr, bytes, prot, flags | populate, -1, 0);
+        if(mem == MAP_FAILED) return nullptr;
+        if(huge_pages) madvise(mem, bytes, MADV_HUGEPAGE);
+    }
+
+    if(prefault)
+    {
+        // MAP_POPULATE is best effort, and THP only kicks in on write
+        auto* bytes_ptr = static_cast<volatile unsigned char*>(mem);
+        for(size_t off=0; off<bytes; off+=4096) bytes_ptr[off] = 0;
+    }
+    return mem;
+}
+
+} // namespace
 
 OrderPool::OrderPool(size_t capacity)
-    : capacity_(capacity)
-    , free_count_(capacity)
+    : OrderPool(OrderPoolConfig{ .initial_capacity = capacity })
 {
-    storage_ = static_cast<Order*>(
-        std::aligned_alloc(64, capacity*sizeof(Order))
-    );
+}
 
-    free_list_ = &storage_[0];
-    for(size_t i=0; i<capacity_-1; i++)
+OrderPool::OrderPool(const OrderPoolConfig& config)
+    : config_(config)
+    , chunk_shift_(0)
+    , chunk_mask_(0)
+    , free_list_(NULL_ORDER)
+    , capacity_(0)
+    , free_count_(0)
+    , exhausted_count_(0)
+{
+    if(config_.chunk_capacity == 0) config_.chunk_capacity = OrderPoolConfig::DEFAULT_CHUNK_ORDERS;
+    config_.chunk_capacity = std::bit_ceil(config_.chunk_capacity);
+    chunk_shift_ = static_cast<unsigned>(std::countr_zero(config_.chunk_capacity));
+    chunk_mask_ = static_cast<uint32_t>(config_.chunk_capacity - 1);
+
+    const size_t chunks = (config_.initial_capacity + config_.chunk_capacity - 1) / config_.chunk_capacity;
+    chunks_.reserve(chunks);
+    for(size_t i=0; i<chunks; i++)
     {
-        storage_[i].next = &storage_[i+1];
+        if(!grow()) break;
     }
-    storage_[capacity_-1].next = nullptr;
 }
 
 OrderPool::~OrderPool()
 {
-    std::free(storage_);
+    for(const Chunk& chunk : chunks_) munmap(chunk.orders, chunk.bytes);
 }
 
 Order* OrderPool::allocate()
 {
-    if(!free_list_) return nullptr; // TODO: need to handle if pool is exhausted
+    if(free_list_ == NULL_ORDER) [[unlikely]]
+    {
+        return allocate_slow();
+    }
 
-    Order* order = free_list_;
+    Order* order = at(free_list_);
     free_list_ = order->next;
     free_count_--;
 
-    order->next = nullptr;
-    order->prev = nullptr;
+    order->next = NULL_ORDER;
+    order->prev = NULL_ORDER;
 
     return order;
 }
@@ -40,6 +93,56 @@ Order* OrderPool::allocate()
 void OrderPool::deallocate(Order* order)
 {
     order->next = free_list_;
-    free_list_ = order;
+    free_list_ = order->index;
     free_count_++;
-}
\ No newline at end of file
+}
+
+bool OrderPool::grow()
+{
+    const size_t orders = config_.chunk_capacity;
+    if(config_.max_capacity != 0 && capacity_ + orders > config_.max_capacity) return false;
+    if(capacity_ + orders > NULL_ORDER) return false; // indices must stay 32-bit
+
+    const size_t page = config_.huge_pages ? OrderPoolConfig::HUGE_PAGE_SIZE : 4096;
+    const size_t bytes = round_up(orders * sizeof(Order), page);
+
+    void* mem = map_chunk(bytes, config_.huge_pages, config_.prefault);
+    if(!mem) return false;
+
+    auto* storage = static_cast<Order*>(mem);
+    chunks_.push_back({ storage, bytes });
+
+    // thread back to front so the chunk is handed out in address order
+    const uint32_t first = static_cast<uint32_t>(capacity_);
+    for(size_t i=orders; i-- > 0;)
+    {
+        storage[i].index = first + static_cast<uint32_t>(i);
+        storage[i].next = free_list_;
+        free_list_ = storage[i].index;
+    }
+
+    capacity_ += orders;
+    free_count_ += orders;
+    return true;
+}
+
+Order* OrderPool::allocate_slow()
+{
+    exhausted_count_++;
+
+    bool retry = false;
+    switch(config_.policy)
+    {
+    case PoolExhaustionPolicy::Grow:
+        retry = grow();
+        break;
+    case PoolExhaustionPolicy::Reject:
+        break;
+    case PoolExhaustionPolicy::Callback:
+        retry = config_.on_exhausted && config_.on_exhausted(*this, config_.on_exhausted_ctx);
+        break;
+    }
+
+    if(!retry || free_list_ == NULL_ORDER) return nullptr;
+    return allocate();
+}
@@ -1,124 +1,243 @@
+#include "book_store.hpp"
+#include "feed_arbiter.hpp"
+#include "hdr_histogram.hpp"
 #include "order_book.hpp"
 #include "market_event.hpp"
 #include "publisher.hpp"
+#include "shm_ring.hpp"
 #include "lat_helper.hpp"
 #include "spsc.hpp"
 #include "mpmc.hpp"
+#include "sharded_mpsc.hpp"
+#include "wait_strategy.hpp"
 
 #include <thread>
 #include <iostream>
 #include <atomic>
+#include <memory>
+#include <optional>
+#include <sstream>
 #include <vector>
+#include <chrono>
 #include <immintrin.h>
 
-int main()
+// order_book [store_dir]: with a store directory the book is recovered from
+// it at startup and every event is journalled into it, see BookStore.
+int main(int argc, char** argv)
 {
 	constexpr size_t QSIZE = 1 << 14;
+	constexpr uint64_t SNAPSHOT_EVERY = 1 << 20; // events between snapshots
+	constexpr uint64_t POLL_EVERY = 1 << 12;     // events between checks on a snapshot writer
+
+	// calibrate_ghz() pins its caller to core 0; keep that off the main thread
+	// so the threads started below do not inherit the mask
+	double ghz = 0;
+	std::thread([&]() { ghz = calibrate_ghz(); }).join();
+
+	// The book and consumer threads park when idle rather than holding a core
+	// each; a symbol hot enough to deserve a dedicated core would use
+	// BusySpin here instead.
+	using Wait = SpinPark<>;
+	mpmc<MarketEvent, std::allocator<MarketEvent>, Wait> event_q(QSIZE);
+
+	// L2/L3 deltas for consumers in other processes, see md_subscriber. The
+	// publisher is a compile-time sink, called directly from the book thread.
+	using DeltaBus = ShmBroadcastWriter<BookDelta>;
+	DeltaBus delta_bus("/order_book_deltas", 1 << 16);
+
+	struct Traits : DefaultBookTraits
+	{
+		using Listeners = StaticListeners<DeltaPublisher<DeltaBus>>;
+	};
 
-	mpmc<MarketEvent> event_q(QSIZE);
-	spsc<TopOfBook> md_q(QSIZE);
+	auto book = std::make_unique<OrderBook<Traits>>(1000, 1000, 1, 1 << 16, HashOrderIndex{},
+		Traits::Listeners(DeltaPublisher<DeltaBus>(delta_bus)));
+	ConflatingMarketDataPublisher<Wait> publisher;
 
-	OrderBook book(1000, 1000);
-	MarketDataPublisher<spsc<TopOfBook>> publisher(md_q);
+	using Store = BookStore<OrderBook<Traits>>;
+	std::optional<Store> store;
+	if(argc > 1)
+	{
+		store.emplace(argv[1]);
+		const uint64_t seq = store->recover(*book);
+		std::cout << "Recovered " << seq << " events from " << argv[1] << "\n";
+	}
 
 	std::atomic<bool> producers_done{false};
-	// Start producer threads
-	std::thread producer([&]()
-						 {
-		MarketEvent ev{};
-		for (Price p=1000; p<1005; ++p) {
-			ev = {EventType::Add, p, 10, true};
-			while(!event_q.push(ev)) _mm_pause();
-		
-			ev = {EventType::Add, p+10, 10, false};
-			while(!event_q.push(ev)) _mm_pause();
+	std::atomic<bool> book_done{false};
+
+	// The feed as the exchange publishes it: every event carries a sequence
+	// number, and redundant lines A and B each deliver a copy.
+	std::vector<SequencedEvent> feed;
+	auto publish = [&](const MarketEvent& ev) { feed.push_back({ .seq = feed.size() + 1, .ev = ev }); };
+
+	uint64_t id = 1;
+	for (Price p=1000; p<1005; ++p) {
+		publish({.order_id = id++, .price = p, .qty = 10, .type = EventType::Add, .side = Side::BID});
+		publish({.order_id = id++, .price = p+10, .qty = 10, .type = EventType::Add, .side = Side::ASK});
+	}
+
+	// Cancel best bid
+	publish({.order_id = 9, .price = 1004, .qty = 10, .type = EventType::Cancel, .side = Side::BID});
+
+	// Cancel best ask
+	publish({.order_id = 2, .price = 1010, .qty = 10, .type = EventType::Cancel, .side = Side::ASK});
+
+	//  Refill liquidity
+	publish({.order_id = id++, .price = 1006, .qty = 20, .type = EventType::Add, .side = Side::BID});
+	publish({.order_id = id++, .price = 1012, .qty = 20, .type = EventType::Add, .side = Side::ASK});
+
+	// Start feed line threads, one lane each. Line A drops every fourth packet
+	// and line B delivers them in swapped pairs, so neither is usable alone.
+	sharded_mpsc<SequencedEvent, Wait> lines_q(2, QSIZE);
+	std::atomic<size_t> lines_done{0};
+
+	auto feed_line = [&](size_t line)
+	{
+		for (size_t i=0; i<feed.size(); i++) {
+			const size_t k = line == 0 ? i : (i ^ 1) < feed.size() ? i ^ 1 : i;
+			if (line == 0 && feed[k].seq % 4 == 0) continue;
+			while(!lines_q.push(line, feed[k])) _mm_pause();
 		}
-	       
-        	// Cancel best bid
-	        ev = {EventType::Cancel, 1004, 10, true};
-	        while (!event_q.push(ev)) _mm_pause();
+		lines_done.fetch_add(1, std::memory_order_release);
+		lines_q.notify();
+	};
+	std::thread line_a(feed_line, 0);
+	std::thread line_b(feed_line, 1);
 
-	        // Cancel best ask
-	        ev = {EventType::Cancel, 1010, 10, false};
-	        while (!event_q.push(ev)) _mm_pause();
+	// Arbitration runs on its own thread so the book thread only ever sees
+	// one ordered, duplicate-free stream.
+	FeedArbiter<> arbiter;
+	std::thread sequencer([&]()
+						  {
+		SequencedEvent packet{};
+		auto to_book = [&](const MarketEvent& ev) {
+			while(!event_q.push(ev)) _mm_pause();
+		};
+		auto stop = [&]() { return lines_done.load(std::memory_order_acquire) == 2; };
 
-	        //  Refill liquidity
-	        ev = {EventType::Add, 1006, 20, true};
-	        while (!event_q.push(ev)) _mm_pause();
+		while(lines_q.pop_wait(packet, stop)) {
+			arbiter.on_packet(packet, to_book);
+		}
+		arbiter.flush(to_book);
 
-	        ev = {EventType::Add, 1012, 20, false};
-	        while (!event_q.push(ev)) _mm_pause();
+		producers_done.store(true, std::memory_order_release);
+		event_q.notify(); });
 
-		producers_done.store(true, std::memory_order_release); });
+	// engine latency in TSC cycles, recorded by the book thread only
+	HdrHistogram<> latency;
 
-	std::vector<uint64_t> latencies;
-	latencies.reserve(1'000'000);
+	auto latency_line = [&](const char* label)
+	{
+		std::ostringstream line;
+		line << label
+			 << " n=" << latency.count()
+			 << " P50=" << cycles_to_ns(latency.value_at(0.50), ghz)
+			 << " P99=" << cycles_to_ns(latency.value_at(0.99), ghz)
+			 << " P999=" << cycles_to_ns(latency.value_at(0.999), ghz)
+			 << " max=" << cycles_to_ns(latency.max(), ghz) << " ns\n";
+		return line.str();
+	};
 
 	// Start order book thread
 	std::thread ob_thread([&]()
 						  {
 		MarketEvent ev{};
+		uint64_t since_snapshot = 0;
+		auto stop = [&]() { return producers_done.load(std::memory_order_acquire); };
 
 		while(true) {
-			if(event_q.pop(ev)) {
-				uint64_t t0 = rdtsc_now();
-				
-				book.on_event(ev);
-				publisher.publish(book);
-
-				uint64_t t1 = rdtsc_now();
-				latencies.push_back(t1 - t0);
-			} else {
-				if(producers_done.load(std::memory_order_acquire)) {
+			if(!event_q.pop(ev)) {
+				// idle: get the journal out before waiting
+				if(store) {
+					store->flush();
+					store->poll();
+				}
+				if(!event_q.pop_wait(ev, stop)) {
 					break;
 				}
-				_mm_pause();
 			}
-		} });
+
+			uint64_t t0 = rdtsc_now();
+
+			// journal first, then apply: a snapshot taken now covers the
+			// recorded event, so it has to be in the book image as well
+			if(store) store->record(ev);
+			book->on_event(ev);
+			if(store) {
+				if(++since_snapshot >= SNAPSHOT_EVERY && store->snapshot(*book)) {
+					since_snapshot = 0;
+				} else if(since_snapshot % POLL_EVERY == 0 && store->snapshot_running()) {
+					// the feed may never go idle; reap the writer so its
+					// journal segments are dropped under load too
+					store->poll();
+				}
+			}
+			publisher.publish(*book);
+
+			uint64_t t1 = rdtsc_now();
+			latency.record(t1 - t0);
+		}
+
+		// leave a snapshot behind so the next start has no journal to replay
+		if(store) {
+			auto wait_for_writer = [&]() {
+				while(store->snapshot_running()) {
+					store->poll();
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+			};
+			wait_for_writer();
+			store->snapshot(*book);
+			wait_for_writer();
+		}
+		book_done.store(true, std::memory_order_release);
+		publisher.notify(); });
 
 	std::thread consumer([&]()
 						 {
+		TopOfBookReader reader(publisher);
 		TopOfBook tob{};
-		while(true) {
-			if(md_q.pop(tob)) {
-				std::cout<<"Best bid: "<<tob.best_bid
-						<<" Best ask: "<<tob.best_ask
-						<<" Spread: "<<tob.spread<<"\n";
-			} else {
-				if(producers_done.load(std::memory_order_acquire) &&
-					md_q.empty()) {
-					break;
-				}
-				_mm_pause();
+		uint64_t gap = 0;
+		auto stop = [&]() { return book_done.load(std::memory_order_acquire); };
+		while(reader.wait(tob, gap, stop)) {
+			std::cout<<"Best bid: "<<tob.best_bid
+					<<" Best ask: "<<tob.best_ask
+					<<" Spread: "<<tob.spread
+					<<" Skipped: "<<gap<<"\n";
+		} });
+
+	// Reads the book thread's histogram live and dumps it while it changes
+	std::thread monitor([&]()
+						{
+		uint64_t last_count = 0;
+		while(!book_done.load(std::memory_order_acquire)) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			const uint64_t n = latency.count();
+			if(n != last_count) {
+				std::cout << latency_line("live");
+				last_count = n;
 			}
 		} });
 
 	// Join threads
-	producer.join();
+	line_a.join();
+	line_b.join();
+	sequencer.join();
 	ob_thread.join();
 	consumer.join();
+	monitor.join();
 
-	std::sort(latencies.begin(), latencies.end());
-	auto pct = [&](double p)
-	{
-		size_t idx = static_cast<size_t>(p * latencies.size());
-		return latencies[std::min(idx, latencies.size() - 1)];
-	};
-
-	double ghz = calibrate_ghz();
-
-	auto to_ns = [&](uint64_t cyc)
-	{
-		return cycles_to_ns(cyc, ghz);
-	};
+	std::cout << "Feed arbitration: " << feed.size() << " events, " << arbiter.duplicates() << " duplicates, "
+			  << arbiter.reordered() << " reordered, " << arbiter.lost() << " lost\n";
 
 	std::cout << "Engine latency (OrderBook + ToB publish)\n";
-	std::cout << "P50  : " << to_ns(pct(0.50)) << " ns\n";
-	std::cout << "P90  : " << to_ns(pct(0.90)) << " ns\n";
-	std::cout << "P99  : " << to_ns(pct(0.99)) << " ns\n";
-	std::cout << "P999 : " << to_ns(pct(0.999)) << " ns\n";
-	std::cout << "Min  : " << to_ns(latencies.front()) << " ns\n";
-	std::cout << "Max  : " << to_ns(latencies.back()) << " ns\n";
+	std::cout << "P50  : " << cycles_to_ns(latency.value_at(0.50), ghz) << " ns\n";
+	std::cout << "P90  : " << cycles_to_ns(latency.value_at(0.90), ghz) << " ns\n";
+	std::cout << "P99  : " << cycles_to_ns(latency.value_at(0.99), ghz) << " ns\n";
+	std::cout << "P999 : " << cycles_to_ns(latency.value_at(0.999), ghz) << " ns\n";
+	std::cout << "Min  : " << cycles_to_ns(latency.min(), ghz) << " ns\n";
+	std::cout << "Max  : " << cycles_to_ns(latency.max(), ghz) << " ns\n";
 
 	return 0;
 }
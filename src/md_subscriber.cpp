@@ -0,0 +1,130 @@
+#include "shm_ring.hpp"
+#include "types.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+
+// Tails the book's delta bus from another process and keeps its own L2 view
+// of the book, printing the BBO whenever it changes.
+//
+//   md_subscriber [--bus NAME] [--idle-ms N]
+//
+// Exits once the bus has been quiet for --idle-ms after the first message.
+
+namespace {
+
+struct Level
+{
+	Qty qty;
+	uint32_t order_count;
+};
+
+class L2Book
+{
+private:
+	std::map<Price, Level, std::greater<Price>> bids_;
+	std::map<Price, Level> asks_;
+
+public:
+	void apply(const BookDelta& d)
+	{
+		switch(d.type)
+		{
+		case DeltaType::LevelAdd:
+		case DeltaType::LevelUpdate:
+			if(d.side == Side::BID) bids_[d.price] = Level{ d.qty, d.order_count };
+			else asks_[d.price] = Level{ d.qty, d.order_count };
+			break;
+		case DeltaType::LevelDelete:
+			if(d.side == Side::BID) bids_.erase(d.price);
+			else asks_.erase(d.price);
+			break;
+		default:
+			break; // order deltas are for L3 consumers
+		}
+	}
+
+	Price best_bid() const noexcept { return bids_.empty() ? INVALID_PRICE : bids_.begin()->first; }
+	Price best_ask() const noexcept { return asks_.empty() ? INVALID_PRICE : asks_.begin()->first; }
+	Qty best_bid_qty() const noexcept { return bids_.empty() ? 0 : bids_.begin()->second.qty; }
+	Qty best_ask_qty() const noexcept { return asks_.empty() ? 0 : asks_.begin()->second.qty; }
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	std::string bus = "/order_book_deltas";
+	long idle_ms = 2000;
+
+	for(int i=1; i<argc; i++)
+	{
+		const std::string arg = argv[i];
+		if(arg == "--bus" && i + 1 < argc) bus = argv[++i];
+		else if(arg == "--idle-ms" && i + 1 < argc) idle_ms = std::strtol(argv[++i], nullptr, 10);
+		else
+		{
+			std::cerr << "usage: md_subscriber [--bus NAME] [--idle-ms N]\n";
+			return 1;
+		}
+	}
+
+	try
+	{
+		// from the oldest message still held, so a late start misses nothing
+		// the ring has not already overwritten
+		ShmBroadcastReader<BookDelta> reader(bus, true, std::chrono::seconds(30));
+
+		L2Book book;
+		BookDelta delta{};
+		uint64_t received = 0;
+		uint64_t gaps = 0;
+		uint64_t expected_seq = 0;
+		Price last_bid = INVALID_PRICE;
+		Price last_ask = INVALID_PRICE;
+		Qty last_bid_qty = 0;
+		Qty last_ask_qty = 0;
+		auto last_message = std::chrono::steady_clock::now();
+
+		while(true)
+		{
+			if(!reader.poll(delta))
+			{
+				if(received && std::chrono::steady_clock::now() - last_message > std::chrono::milliseconds(idle_ms)) break;
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+				continue;
+			}
+
+			if(expected_seq && delta.seq != expected_seq) gaps++;
+			expected_seq = delta.seq + 1;
+			received++;
+			last_message = std::chrono::steady_clock::now();
+
+			book.apply(delta);
+			if(book.best_bid() != last_bid || book.best_ask() != last_ask ||
+			   book.best_bid_qty() != last_bid_qty || book.best_ask_qty() != last_ask_qty)
+			{
+				last_bid = book.best_bid();
+				last_ask = book.best_ask();
+				last_bid_qty = book.best_bid_qty();
+				last_ask_qty = book.best_ask_qty();
+				std::cout << "seq " << delta.seq << " BBO " << last_bid_qty << " @ " << last_bid
+						  << " / " << last_ask_qty << " @ " << last_ask << "\n";
+			}
+		}
+
+		std::cout << "received " << received << " deltas, " << gaps << " sequence gaps, "
+				  << reader.lost() << " overwritten before read\n";
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << "md_subscriber: " << e.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
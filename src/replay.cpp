@@ -0,0 +1,352 @@
+#include "capture_file.hpp"
+#include "itch.hpp"
+#include "lat_helper.hpp"
+#include "market_event.hpp"
+#include "order_book.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <immintrin.h>
+
+// Replays a capture file through one OrderBook, either an ITCH 5.0
+// BinaryFILE (one stock, picked by --symbol or --locate) or the internal
+// format from capture_file.hpp. --convert turns the selected ITCH stock into
+// an internal capture instead of replaying it.
+//
+//   order_book_replay <file> [--symbol AAPL | --locate N] [--tick T]
+//                            [--pace SPEED] [--convert OUT] [--populate]
+
+namespace {
+
+struct Options
+{
+	std::string path;
+	std::string symbol;
+	uint16_t locate = 0;
+	Price tick_size = 100; // ITCH prices carry 4 decimals, so 100 is a cent
+	double pace = 0.0;     // 0 replays at max speed, 1.0 at recorded pace
+	std::string convert;
+	bool populate = false;
+};
+
+void usage()
+{
+	std::cerr << "usage: order_book_replay <file> [--symbol SYM | --locate N] [--tick T]\n"
+			  << "                         [--pace SPEED] [--convert OUT] [--populate]\n";
+}
+
+std::optional<Options> parse_args(int argc, char** argv)
+{
+	Options opt;
+	for(int i=1; i<argc; i++)
+	{
+		const std::string arg = argv[i];
+		const bool has_value = i + 1 < argc;
+
+		if(arg == "--symbol" && has_value) opt.symbol = argv[++i];
+		else if(arg == "--locate" && has_value) opt.locate = static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if(arg == "--tick" && has_value) opt.tick_size = static_cast<Price>(std::strtoul(argv[++i], nullptr, 10));
+		else if(arg == "--pace" && has_value) opt.pace = std::strtod(argv[++i], nullptr);
+		else if(arg == "--convert" && has_value) opt.convert = argv[++i];
+		else if(arg == "--populate") opt.populate = true;
+		else if(opt.path.empty() && arg[0] != '-') opt.path = arg;
+		else return std::nullopt;
+	}
+
+	if(opt.path.empty() || opt.tick_size == 0) return std::nullopt;
+	return opt;
+}
+
+// Holds event timestamps to wall-clock: event t is applied no earlier than
+// (t - first) / speed after the first one. Long gaps sleep, short ones spin.
+class Pacer
+{
+private:
+	double speed_;
+	bool started_ = false;
+	uint64_t first_ts_ = 0;
+	uint64_t start_ns_ = 0;
+
+public:
+	explicit Pacer(double speed) : speed_(speed) {}
+
+	bool enabled() const noexcept { return speed_ > 0.0; }
+
+	void wait(uint64_t ts) noexcept
+	{
+		if(!started_)
+		{
+			started_ = true;
+			first_ts_ = ts;
+			start_ns_ = monotonic_raw_ns();
+			return;
+		}
+
+		const uint64_t offset = ts > first_ts_ ? ts - first_ts_ : 0;
+		const uint64_t target = start_ns_ + static_cast<uint64_t>(double(offset) / speed_);
+
+		for(uint64_t now = monotonic_raw_ns(); now < target; now = monotonic_raw_ns())
+		{
+			const uint64_t left = target - now;
+			if(left > 200'000) std::this_thread::sleep_for(std::chrono::nanoseconds(left - 100'000));
+			else _mm_pause();
+		}
+	}
+};
+
+// Applies events to one book. The ladders start at zero and recenter onto
+// the instrument's price with its first quote, and the pool and index are
+// sized up front so the timed replay does not pay for first-touch faults.
+// Adds and replaces only rest: the feed already reports the venue's own
+// executions, and its book can lock or cross during the auctions.
+class BookSink
+{
+private:
+	Pacer& pacer_;
+	std::unique_ptr<OrderBook<>> book_;
+
+public:
+	uint64_t applied = 0;
+	uint64_t rejected = 0;
+
+	BookSink(Price tick_size, Pacer& pacer)
+		: pacer_(pacer),
+		  book_(std::make_unique<OrderBook<>>(0, 0, tick_size, EXPECTED_ORDERS, HashOrderIndex(EXPECTED_ORDERS))) {}
+
+	void operator()(const MarketEvent& ev, uint64_t ts)
+	{
+		if(pacer_.enabled()) pacer_.wait(ts);
+
+		if(ev.type == EventType::Add)
+		{
+			const AddResult r = book_->rest_order(ev.order_id, ev.price, ev.qty, ev.side);
+			if(r == AddResult::InvalidPrice || r == AddResult::PoolExhausted) rejected++;
+		}
+		else
+		{
+			book_->on_feed_event(ev);
+		}
+		applied++;
+	}
+
+	// Bulk path for the internal format at max speed
+	void apply(std::span<const MarketEvent> events)
+	{
+		rejected += book_->on_feed_events(events);
+		applied += events.size();
+	}
+
+	const OrderBook<>& book() const noexcept { return *book_; }
+
+private:
+	static constexpr size_t EXPECTED_ORDERS = size_t{1} << 20;
+};
+
+class ConvertSink
+{
+private:
+	CaptureWriter writer_;
+
+public:
+	explicit ConvertSink(const std::string& path) : writer_(path) {}
+
+	void operator()(const MarketEvent& ev, uint64_t ts) { writer_.write(ev, ts); }
+
+	uint64_t written() const noexcept { return writer_.count(); }
+	void close() { writer_.close(); }
+};
+
+// Turns the ITCH order messages of one stock into MarketEvents. ITCH refers
+// to resting orders by reference only, which is all the book needs, so the
+// translator is stateless apart from the stock filter.
+template <typename Sink>
+class ItchTranslator
+{
+private:
+	Sink& sink_;
+	char symbol_[8];
+	bool by_symbol_;
+	uint16_t locate_;
+
+public:
+	ItchTranslator(Sink& sink, const std::string& symbol, uint16_t locate)
+		: sink_(sink), by_symbol_(!symbol.empty()), locate_(locate)
+	{
+		// ITCH stock fields are left-aligned and space padded
+		std::memset(symbol_, ' ', sizeof(symbol_));
+		std::memcpy(symbol_, symbol.data(), std::min(symbol.size(), sizeof(symbol_)));
+	}
+
+	uint16_t locate() const noexcept { return locate_; }
+
+	void on_directory(const itch::Header& h, const char (&stock)[8])
+	{
+		if(by_symbol_ && std::memcmp(stock, symbol_, sizeof(symbol_)) == 0) locate_ = h.stock_locate;
+	}
+
+	void on_add(const itch::Header& h, uint64_t ref, Side side, uint32_t shares, uint32_t price)
+	{
+		if(h.stock_locate == locate_) emit(h, MarketEvent{ .order_id = ref, .price = price, .qty = shares, .type = EventType::Add, .side = side });
+	}
+
+	void on_execute(const itch::Header& h, uint64_t ref, uint32_t shares)
+	{
+		if(h.stock_locate == locate_) emit(h, MarketEvent{ .order_id = ref, .price = 0, .qty = shares, .type = EventType::Trade, .side = Side::BID });
+	}
+
+	// The print price can differ from the limit (e.g. cross executions); the
+	// book reports the execution at the order's own level.
+	void on_execute_at(const itch::Header& h, uint64_t ref, uint32_t shares, uint32_t)
+	{
+		on_execute(h, ref, shares);
+	}
+
+	void on_cancel(const itch::Header& h, uint64_t ref, uint32_t shares)
+	{
+		if(h.stock_locate == locate_) emit(h, MarketEvent{ .order_id = ref, .price = 0, .qty = shares, .type = EventType::Reduce, .side = Side::BID });
+	}
+
+	void on_delete(const itch::Header& h, uint64_t ref)
+	{
+		if(h.stock_locate == locate_) emit(h, MarketEvent{ .order_id = ref, .price = 0, .qty = 0, .type = EventType::Cancel, .side = Side::BID });
+	}
+
+	// ITCH replaces always take a new reference and lose priority
+	void on_replace(const itch::Header& h, uint64_t old_ref, uint64_t new_ref, uint32_t shares, uint32_t price)
+	{
+		if(h.stock_locate != locate_) return;
+
+		emit(h, MarketEvent{
+			.order_id = old_ref,
+			.price = price,
+			.qty = shares,
+			.type = EventType::Replace,
+			.side = Side::BID,
+			.new_order_id = new_ref
+		});
+	}
+
+private:
+	void emit(const itch::Header& h, const MarketEvent& ev)
+	{
+		sink_(ev, h.timestamp_ns);
+	}
+};
+
+void report(const char* what, uint64_t messages, uint64_t events, uint64_t elapsed_ns)
+{
+	const double secs = double(elapsed_ns) * 1e-9;
+	std::cout << what << ": " << messages << " messages, " << events << " book events in " << secs << " s";
+	if(elapsed_ns > 0)
+	{
+		std::cout << " (" << double(messages) / secs / 1e6 << " M msg/s, "
+				  << (events ? double(elapsed_ns) / double(events) : 0.0) << " ns/event)";
+	}
+	std::cout << "\n";
+}
+
+void report_book(const BookSink& sink)
+{
+	std::cout << "applied " << sink.applied << ", rejected adds " << sink.rejected << "\n";
+
+	const OrderBook<>& book = sink.book();
+	std::cout << "final BBO: " << book.best_bid_qty() << " @ " << book.best_bid()
+			  << " / " << book.best_ask_qty() << " @ " << book.best_ask() << "\n";
+}
+
+int replay_itch(const Options& opt, const MappedFile& file)
+{
+	if(opt.symbol.empty() && opt.locate == 0)
+	{
+		std::cerr << "ITCH replay needs --symbol or --locate\n";
+		return 1;
+	}
+
+	if(!opt.convert.empty())
+	{
+		ConvertSink sink(opt.convert);
+		ItchTranslator<ConvertSink> translator(sink, opt.symbol, opt.locate);
+
+		const uint64_t t0 = monotonic_raw_ns();
+		const uint64_t messages = itch::decode(file.data(), file.size(), translator);
+		sink.close();
+		report("convert", messages, sink.written(), monotonic_raw_ns() - t0);
+		return 0;
+	}
+
+	Pacer pacer(opt.pace);
+	BookSink sink(opt.tick_size, pacer);
+	ItchTranslator<BookSink> translator(sink, opt.symbol, opt.locate);
+
+	const uint64_t t0 = monotonic_raw_ns();
+	const uint64_t messages = itch::decode(file.data(), file.size(), translator);
+	report("itch", messages, sink.applied, monotonic_raw_ns() - t0);
+
+	if(translator.locate() == 0) std::cerr << "symbol " << opt.symbol << " not found in stock directory\n";
+	report_book(sink);
+	return 0;
+}
+
+int replay_capture(const Options& opt, const MappedFile& file)
+{
+	const CaptureView capture(file.data(), file.size());
+	const auto events = capture.events();
+	const auto stamps = capture.timestamps();
+
+	Pacer pacer(opt.pace);
+	BookSink sink(opt.tick_size, pacer);
+
+	const uint64_t t0 = monotonic_raw_ns();
+	if(pacer.enabled())
+	{
+		for(size_t i=0; i<events.size(); i++) sink(events[i], stamps[i]);
+	}
+	else
+	{
+		sink.apply(events);
+	}
+	report("capture", events.size(), sink.applied, monotonic_raw_ns() - t0);
+	report_book(sink);
+	return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const std::optional<Options> opt = parse_args(argc, argv);
+	if(!opt)
+	{
+		usage();
+		return 1;
+	}
+
+	try
+	{
+		const MappedFile file(opt->path, opt->populate);
+
+		if(CaptureView::matches(file.data(), file.size()))
+		{
+			if(!opt->convert.empty())
+			{
+				std::cerr << "--convert only applies to ITCH input\n";
+				return 1;
+			}
+			return replay_capture(*opt, file);
+		}
+		return replay_itch(*opt, file);
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << "replay failed: " << e.what() << "\n";
+		return 1;
+	}
+}
@@ -0,0 +1,293 @@
+#include "order_book.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+// OrderBook built from non-default traits (a 64-level ladder, the tick fixed
+// at compile time) against a std::map price-time model: after random adds,
+// cancels, modifies and replaces, the trade sequence and both sides' depth
+// must match. Prices range past the ladder so the overflow map takes part.
+
+struct SmallTraits : DefaultBookTraits
+{
+	static constexpr size_t LADDER_LEVELS = 64;
+	static constexpr Price TICK_SIZE = 1;
+};
+
+namespace {
+
+constexpr Price MID = 1000;
+constexpr size_t DEPTH = 512;
+
+struct Fill
+{
+	uint64_t maker;
+	uint64_t taker;
+	Price price;
+	Qty qty;
+	Side aggressor;
+
+	bool operator==(const Fill&) const = default;
+};
+
+struct Recorder : IOrderBookListener
+{
+	std::vector<Fill> fills;
+
+	void on_book_update(const TopOfBook&) override {}
+	void on_trade(const Trade& t) override { fills.push_back({ t.maker_order_id, t.taker_order_id, t.price, t.qty, t.aggressor }); }
+};
+
+// Price levels of resting (id, qty) in time order.
+class Model
+{
+public:
+	struct Resting
+	{
+		uint64_t id;
+		Qty qty;
+	};
+
+	std::map<Price, std::list<Resting>, std::greater<Price>> bids;
+	std::map<Price, std::list<Resting>> asks;
+	std::map<uint64_t, std::pair<Side, Price>> where;
+	std::vector<Fill> fills;
+
+	void add(uint64_t id, Price price, Qty qty, Side side)
+	{
+		qty = side == Side::BID ? match(asks, price, qty, id, side) : match(bids, price, qty, id, side);
+		if(qty == 0) return;
+		level(side, price).push_back({ id, qty });
+		where[id] = { side, price };
+	}
+
+	void cancel(uint64_t id)
+	{
+		auto w = where.find(id);
+		if(w == where.end()) return;
+		const auto [side, price] = w->second;
+		level(side, price).erase(find(id));
+		where.erase(w);
+		erase_if_empty(side, price);
+	}
+
+	// a size increase loses time priority, a decrease keeps it
+	void modify(uint64_t id, Qty qty)
+	{
+		auto w = where.find(id);
+		if(w == where.end()) return;
+		if(qty == 0) { cancel(id); return; }
+
+		const auto [side, price] = w->second;
+		auto it = find(id);
+		if(qty > it->qty)
+		{
+			auto& l = level(side, price);
+			l.erase(it);
+			l.push_back({ id, qty });
+		}
+		else
+		{
+			it->qty = qty;
+		}
+	}
+
+	void replace(uint64_t id, Price new_price, Qty qty, uint64_t new_id)
+	{
+		auto w = where.find(id);
+		if(w == where.end()) return;
+		if(qty == 0) { cancel(id); return; }
+
+		const auto [side, price] = w->second;
+		const bool rekey = new_id != 0 && new_id != id;
+		if(new_price == price && !rekey) { modify(id, qty); return; }
+		cancel(id);
+		add(rekey ? new_id : id, new_price, qty, side);
+	}
+
+private:
+	template <typename Levels>
+	Qty match(Levels& book, Price limit, Qty qty, uint64_t taker, Side aggressor)
+	{
+		while(qty > 0 && !book.empty())
+		{
+			auto it = book.begin();
+			const Price price = it->first;
+			if(aggressor == Side::BID ? price > limit : price < limit) break;
+
+			auto& l = it->second;
+			while(qty > 0 && !l.empty())
+			{
+				Resting& maker = l.front();
+				const Qty fill = std::min(qty, maker.qty);
+				qty -= fill;
+				maker.qty -= fill;
+				fills.push_back({ maker.id, taker, price, fill, aggressor });
+				if(maker.qty == 0)
+				{
+					where.erase(maker.id);
+					l.pop_front();
+				}
+			}
+			if(l.empty()) book.erase(it);
+		}
+		return qty;
+	}
+
+	std::list<Resting>& level(Side side, Price price) { return side == Side::BID ? bids[price] : asks[price]; }
+
+	void erase_if_empty(Side side, Price price)
+	{
+		if(side == Side::BID && bids[price].empty()) bids.erase(price);
+		if(side == Side::ASK && asks[price].empty()) asks.erase(price);
+	}
+
+	std::list<Resting>::iterator find(uint64_t id)
+	{
+		const auto [side, price] = where.at(id);
+		auto& l = level(side, price);
+		return std::find_if(l.begin(), l.end(), [id](const Resting& r) { return r.id == id; });
+	}
+};
+
+template <typename Levels>
+void check_side(const Levels& model, const std::array<DepthLevel, DEPTH>& levels, size_t n, const char* name, uint64_t seed)
+{
+	CHECK(n == model.size(), "%s level count %zu vs %zu, seed %lu", name, n, model.size(), static_cast<unsigned long>(seed));
+
+	size_t i = 0;
+	for(const auto& [price, orders] : model)
+	{
+		uint64_t qty = 0;
+		for(const auto& o : orders) qty += o.qty;
+		CHECK(levels[i].price == price && levels[i].qty == qty && levels[i].order_count == orders.size(),
+			"%s level %zu, seed %lu", name, i, static_cast<unsigned long>(seed));
+		i++;
+	}
+}
+
+void run(uint64_t seed)
+{
+	// the constructor's tick is overridden by SmallTraits::TICK_SIZE
+	auto book = std::make_unique<OrderBook<SmallTraits>>(MID, MID, 7, 1 << 16);
+	CHECK(book->tick_size() == 1, "traits tick size not applied");
+
+	Recorder recorder;
+	book->add_listener(&recorder);
+	Model model;
+
+	std::mt19937 rng(static_cast<uint32_t>(seed));
+	std::vector<uint64_t> ids;
+	uint64_t next_id = 1;
+
+	// a live order id, dropping ids the model has already filled or cancelled
+	auto pick = [&]() -> uint64_t
+	{
+		while(!ids.empty())
+		{
+			const size_t k = rng() % ids.size();
+			if(model.where.count(ids[k])) return ids[k];
+			ids[k] = ids.back();
+			ids.pop_back();
+		}
+		return 0;
+	};
+
+	// bids and asks overlap by a few ticks, so some adds cross
+	auto random_price = [&](Side side, Price overlap)
+	{
+		const Price offset = static_cast<Price>(rng() % 80);
+		return side == Side::BID ? MID - offset + overlap : MID + offset - overlap;
+	};
+
+	for(int step=0; step<20'000; step++)
+	{
+		const int op = static_cast<int>(rng() % 12);
+		if(op < 4)
+		{
+			const Side side = rng() % 2 ? Side::BID : Side::ASK;
+			const Price price = random_price(side, 2);
+			const Qty qty = 1 + static_cast<Qty>(rng() % 50);
+			book->add_order(next_id, price, qty, side);
+			model.add(next_id, price, qty, side);
+			ids.push_back(next_id++);
+			continue;
+		}
+
+		const uint64_t id = pick();
+		if(id == 0) continue;
+		const auto [side, price] = model.where[id];
+
+		if(op < 6)
+		{
+			book->cancel_order(id);
+			model.cancel(id);
+		}
+		else if(op < 8)
+		{
+			const Qty qty = static_cast<Qty>(rng() % 80);
+			book->modify_order(id, qty);
+			model.modify(id, qty);
+		}
+		else
+		{
+			const Price new_price = rng() % 3 == 0 ? price : random_price(side, 4);
+			const Qty qty = static_cast<Qty>(rng() % 60);
+			const uint64_t new_id = rng() % 2 ? next_id++ : 0;
+			if(new_id) ids.push_back(new_id);
+			book->replace_order(id, new_price, qty, new_id);
+			model.replace(id, new_price, qty, new_id);
+		}
+	}
+
+	CHECK(recorder.fills.size() == model.fills.size(), "trade count %zu vs %zu, seed %lu",
+		recorder.fills.size(), model.fills.size(), static_cast<unsigned long>(seed));
+	for(size_t i=0; i<model.fills.size(); i++)
+	{
+		CHECK(recorder.fills[i] == model.fills[i], "trade %zu differs, seed %lu", i, static_cast<unsigned long>(seed));
+	}
+
+	const auto depth = book->get_depth<DEPTH>();
+	check_side(model.bids, depth.bids, depth.bid_levels, "bid", seed);
+	check_side(model.asks, depth.asks, depth.ask_levels, "ask", seed);
+}
+
+// replace_order's results for the cases that do not reach the model
+void test_replace_results()
+{
+	auto book = std::make_unique<OrderBook<SmallTraits>>(MID, MID, 1, 1 << 10);
+	book->add_order(1, MID - 1, 10, Side::BID);
+	book->add_order(2, MID - 2, 20, Side::BID);
+
+	// re-keying onto a live id is refused and touches neither order
+	CHECK(book->replace_order(1, MID - 3, 5, 2) == AddResult::DuplicateOrder, "re-key onto a live id");
+	auto depth = book->get_depth<DEPTH>();
+	CHECK(depth.bid_levels == 2 && depth.bids[0].price == MID - 1 && depth.bids[0].qty == 10
+		&& depth.bids[1].price == MID - 2 && depth.bids[1].qty == 20, "book changed by a rejected replace");
+
+	CHECK(book->replace_order(1, MID - 1, 0) == AddResult::Cancelled, "replace to zero quantity");
+	CHECK(book->replace_order(1, MID - 1, 5) == AddResult::UnknownOrder, "order still live after replace to zero");
+
+	// the cancelled id is free to be re-keyed onto again
+	CHECK(book->replace_order(2, MID - 2, 20, 1) == AddResult::Rested, "re-key onto a free id");
+	depth = book->get_depth<DEPTH>();
+	CHECK(depth.bid_levels == 1 && depth.bids[0].qty == 20, "re-keyed book");
+	CHECK(book->replace_order(2, MID - 2, 5) == AddResult::UnknownOrder, "old id still live after re-key");
+}
+
+} // namespace
+
+int main()
+{
+	test_replace_results();
+	for(uint64_t seed=0; seed<20; seed++) run(seed);
+
+	std::printf("book_model_test: ok\n");
+	return 0;
+}
@@ -0,0 +1,128 @@
+#include "order_book.hpp"
+#include "check.hpp"
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+// OrderBook's incrementally kept signals against a recomputation from the
+// full depth after every operation, for a range of signal windows. The mid
+// walks upwards in steps so the ladder recenters under the sums.
+
+namespace {
+
+constexpr Price MID = 100'000;
+constexpr Price TICK = 5;
+constexpr size_t DEPTH = 4096;
+
+struct Expected
+{
+	uint64_t depth = 0;
+	uint64_t weighted = 0;
+};
+
+Expected recompute(const std::array<DepthLevel, DEPTH>& levels, size_t n, Side side, uint32_t depth_ticks, uint32_t weight_ticks)
+{
+	Expected e;
+	if(n == 0) return e;
+
+	const Price best = levels[0].price;
+	for(size_t i=0; i<n; i++)
+	{
+		const uint64_t distance = (side == Side::BID ? best - levels[i].price : levels[i].price - best) / TICK;
+		if(distance < depth_ticks) e.depth += levels[i].qty;
+		if(distance < weight_ticks) e.weighted += (weight_ticks - distance) * levels[i].qty;
+	}
+	return e;
+}
+
+double ratio(uint64_t bid, uint64_t ask)
+{
+	const double b = static_cast<double>(bid);
+	const double a = static_cast<double>(ask);
+	return b + a == 0 ? 0.0 : (b - a) / (b + a);
+}
+
+void run(uint64_t seed)
+{
+	auto book = std::make_unique<OrderBook<>>(MID, MID, TICK, 1 << 16);
+	const uint32_t depth_ticks = 1 + static_cast<uint32_t>(seed) * 3;
+	const uint32_t weight_ticks = 1 + static_cast<uint32_t>(seed) * 2;
+	book->set_signal_window(depth_ticks, weight_ticks);
+
+	std::mt19937_64 rng(seed);
+	std::vector<uint64_t> ids;
+	uint64_t next_id = 1;
+
+	for(int step=0; step<40'000; step++)
+	{
+		const Price mid = MID + TICK * static_cast<Price>((step / 4000) * 300);
+		if(rng() % 10 < 5 || ids.empty())
+		{
+			const Side side = rng() % 2 ? Side::BID : Side::ASK;
+			const Price price = side == Side::BID
+				? mid - TICK * static_cast<Price>(rng() % 40) + 2 * TICK
+				: mid + TICK * static_cast<Price>(rng() % 40) - 2 * TICK;
+			book->add_order(next_id, price, 1 + static_cast<Qty>(rng() % 100), side);
+			ids.push_back(next_id++);
+		}
+		else
+		{
+			const size_t k = rng() % ids.size();
+			const uint64_t id = ids[k];
+			switch(rng() % 4)
+			{
+				case 0:
+					book->cancel_order(id);
+					ids[k] = ids.back();
+					ids.pop_back();
+					break;
+				case 1:
+					book->modify_order(id, static_cast<Qty>(rng() % 120));
+					break;
+				case 2:
+					book->execute_order(id, static_cast<Qty>(rng() % 50));
+					break;
+				default:
+					book->replace_order(id, mid + TICK * static_cast<Price>(rng() % 20) - 10 * TICK,
+						1 + static_cast<Qty>(rng() % 80), rng() % 2 ? next_id++ : 0);
+					break;
+			}
+		}
+
+		const auto depth = book->get_depth<DEPTH>();
+		const BookSignals& signals = book->signals();
+		const Expected bid = recompute(depth.bids, depth.bid_levels, Side::BID, depth_ticks, weight_ticks);
+		const Expected ask = recompute(depth.asks, depth.ask_levels, Side::ASK, depth_ticks, weight_ticks);
+
+		double microprice = 0.0;
+		if(depth.bid_levels && depth.ask_levels)
+		{
+			const double bid_qty = depth.bids[0].qty;
+			const double ask_qty = depth.asks[0].qty;
+			microprice = (depth.bids[0].price * ask_qty + depth.asks[0].price * bid_qty) / (bid_qty + ask_qty);
+		}
+
+		CHECK(signals.bid_depth == bid.depth && signals.ask_depth == ask.depth, "depth, seed %lu step %d",
+			static_cast<unsigned long>(seed), step);
+		CHECK(signals.pressure == static_cast<int64_t>(bid.weighted) - static_cast<int64_t>(ask.weighted),
+			"pressure, seed %lu step %d", static_cast<unsigned long>(seed), step);
+		CHECK(std::fabs(signals.depth_imbalance - ratio(bid.depth, ask.depth)) < 1e-9,
+			"depth_imbalance, seed %lu step %d", static_cast<unsigned long>(seed), step);
+		CHECK(std::fabs(signals.weighted_imbalance - ratio(bid.weighted, ask.weighted)) < 1e-9,
+			"weighted_imbalance, seed %lu step %d", static_cast<unsigned long>(seed), step);
+		CHECK(std::fabs(signals.microprice - microprice) < 1e-6, "microprice, seed %lu step %d",
+			static_cast<unsigned long>(seed), step);
+	}
+}
+
+} // namespace
+
+int main()
+{
+	for(uint64_t seed=0; seed<6; seed++) run(seed);
+
+	std::printf("book_signals_test: ok\n");
+	return 0;
+}
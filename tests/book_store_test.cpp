@@ -0,0 +1,219 @@
+#include "book_store.hpp"
+#include "order_book.hpp"
+#include "check.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// BookStore recovery: a snapshot plus journal tail rebuilds the live book,
+// queue order included, for both a matching book and a feed-driven one that
+// is left crossed; and a zeroed hole in a segment stops recovery there
+// without costing the events journalled after a later restart.
+
+namespace {
+
+using Book = OrderBook<>;
+
+constexpr Price MID = 100'000;
+constexpr size_t POOL = 1 << 16;
+
+std::filesystem::path store_dir()
+{
+	return std::filesystem::temp_directory_path() / ("book_store_test." + std::to_string(::getpid()));
+}
+
+// Adds either side of MID that overlap by a few ticks, so a matching book
+// trades and a feed-driven one ends up crossed, plus cancels, reduces and
+// re-keying replaces of live orders.
+std::vector<MarketEvent> make_events(size_t n, uint64_t seed, uint64_t first_id)
+{
+	std::mt19937_64 rng(seed);
+	std::vector<uint64_t> live;
+	std::vector<MarketEvent> events;
+	uint64_t next_id = first_id;
+
+	for(size_t i=0; i<n; i++)
+	{
+		const uint64_t r = rng() % 10;
+		if(live.empty() || r < 5)
+		{
+			const bool bid = rng() % 2;
+			const Price offset = static_cast<Price>(rng() % 200);
+			events.push_back({ .order_id = next_id, .price = bid ? MID - offset + 3 : MID + offset - 3,
+				.qty = 1 + static_cast<Qty>(rng() % 50), .type = EventType::Add, .side = bid ? Side::BID : Side::ASK });
+			live.push_back(next_id++);
+			continue;
+		}
+
+		const size_t k = rng() % live.size();
+		const uint64_t id = live[k];
+		if(r < 7)
+		{
+			events.push_back({ .order_id = id, .price = 0, .qty = 0, .type = EventType::Cancel, .side = Side::BID });
+			live[k] = live.back();
+			live.pop_back();
+		}
+		else if(r < 8)
+		{
+			events.push_back({ .order_id = id, .price = 0, .qty = 1, .type = EventType::Reduce, .side = Side::BID });
+		}
+		else
+		{
+			events.push_back({ .order_id = id, .price = MID + static_cast<Price>(rng() % 100) - 50, .qty = 5,
+				.type = EventType::Replace, .side = Side::BID, .new_order_id = next_id });
+			live[k] = next_id++;
+		}
+	}
+	return events;
+}
+
+template <bool Match>
+void apply(Book& book, const MarketEvent& ev)
+{
+	if constexpr (Match) book.on_event(ev);
+	else book.on_feed_event(ev);
+}
+
+template <typename Store>
+void wait_for_writer(Store& store)
+{
+	while(store.snapshot_running())
+	{
+		store.poll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	CHECK(store.failed_snapshots() == 0, "snapshot writer failed");
+}
+
+void check_same(const Book& a, const Book& b, const char* what)
+{
+	std::vector<std::pair<uint64_t, Qty>> orders_a;
+	std::vector<std::pair<uint64_t, Qty>> orders_b;
+	std::vector<Price> prices_a;
+	std::vector<Price> prices_b;
+	a.for_each_order([&](const Order& o, Price p) { orders_a.emplace_back(o.order_id, o.quantity); prices_a.push_back(p); });
+	b.for_each_order([&](const Order& o, Price p) { orders_b.emplace_back(o.order_id, o.quantity); prices_b.push_back(p); });
+	CHECK(orders_a == orders_b && prices_a == prices_b, "%s: recovered book differs (%zu vs %zu orders)", what, orders_a.size(), orders_b.size());
+}
+
+struct TradeCounter : IOrderBookListener
+{
+	uint64_t trades = 0;
+	void on_book_update(const TopOfBook&) override {}
+	void on_trade(const Trade&) override { trades++; }
+};
+
+// Journals a run with a snapshot part way through, then recovers into a
+// fresh book and compares.
+template <bool Match>
+void test_round_trip(const char* what)
+{
+	const auto dir = store_dir();
+	std::filesystem::remove_all(dir);
+	const std::vector<MarketEvent> events = make_events(100'000, 1, 1);
+
+	auto live = std::make_unique<Book>(MID, MID, 1, POOL);
+	{
+		BookStore<Book, Match> store(dir);
+		store.recover(*live);
+		for(size_t i=0; i<events.size(); i++)
+		{
+			store.record(events[i]);
+			apply<Match>(*live, events[i]);
+			if(i == events.size() / 2) store.snapshot(*live);
+		}
+		wait_for_writer(store);
+	}
+
+	if constexpr (!Match)
+	{
+		CHECK(live->best_bid() >= live->best_ask(), "%s: feed-driven book never crossed, test is not covering it", what);
+	}
+
+	auto recovered = std::make_unique<Book>(MID, MID, 1, POOL);
+	TradeCounter counter;
+	recovered->add_listener(&counter);
+	{
+		BookStore<Book, Match> store(dir);
+		CHECK(store.recover(*recovered) == events.size(), "%s: recovered seq", what);
+	}
+	check_same(*live, *recovered, what);
+	if constexpr (!Match) CHECK(counter.trades == 0, "%s: recovery traded %lu times", what, static_cast<unsigned long>(counter.trades));
+
+	std::filesystem::remove_all(dir);
+}
+
+// Zeroes one record in the middle of the only segment, recovers, journals
+// more, and recovers again: the second recovery must keep the new events.
+void test_hole()
+{
+	const auto dir = store_dir();
+	std::filesystem::remove_all(dir);
+	const std::vector<MarketEvent> events = make_events(10'000, 2, 1);
+	const std::vector<MarketEvent> more = make_events(1'000, 3, 1'000'000);
+	constexpr size_t HOLE = 6'000; // index of the zeroed record, seq HOLE + 1
+
+	{
+		auto book = std::make_unique<Book>(MID, MID, 1, POOL);
+		BookStore<Book> store(dir);
+		store.recover(*book);
+		for(const MarketEvent& ev : events)
+		{
+			store.record(ev);
+			book->on_event(ev);
+		}
+	}
+
+	std::filesystem::path segment;
+	for(const auto& entry : std::filesystem::directory_iterator(dir)) segment = entry.path();
+	{
+		std::FILE* f = std::fopen(segment.c_str(), "r+b");
+		CHECK(f != nullptr, "open %s", segment.c_str());
+		const JournalRecord zero{};
+		std::fseek(f, static_cast<long>(sizeof(JournalHeader) + HOLE * sizeof(JournalRecord)), SEEK_SET);
+		std::fwrite(&zero, sizeof(zero), 1, f);
+		std::fclose(f);
+	}
+
+	auto expected = std::make_unique<Book>(MID, MID, 1, POOL);
+	for(size_t i=0; i<HOLE; i++) expected->on_event(events[i]);
+
+	auto first = std::make_unique<Book>(MID, MID, 1, POOL);
+	{
+		BookStore<Book> store(dir);
+		CHECK(store.recover(*first) == HOLE, "recovery did not stop at the hole");
+		for(const MarketEvent& ev : more)
+		{
+			store.record(ev);
+			first->on_event(ev);
+			expected->on_event(ev);
+		}
+	}
+	check_same(*expected, *first, "after the hole");
+
+	auto second = std::make_unique<Book>(MID, MID, 1, POOL);
+	{
+		BookStore<Book> store(dir);
+		CHECK(store.recover(*second) == HOLE + more.size(), "events journalled after the first recovery were lost");
+	}
+	check_same(*expected, *second, "second recovery");
+
+	std::filesystem::remove_all(dir);
+}
+
+} // namespace
+
+int main()
+{
+	test_round_trip<true>("matching");
+	test_round_trip<false>("feed-driven");
+	test_hole();
+
+	std::printf("book_store_test: ok\n");
+	return 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+
+// Minimal assertion for the test executables: prints where and why, then
+// fails the process so ctest reports it. Unlike assert() it survives NDEBUG.
+#define CHECK(cond, ...)                                                  \
+	do                                                                    \
+	{                                                                     \
+		if(!(cond))                                                       \
+		{                                                                 \
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed: ", __FILE__, __LINE__, #cond); \
+			std::fprintf(stderr, __VA_ARGS__);                            \
+			std::fprintf(stderr, "\n");                                   \
+			std::exit(1);                                                 \
+		}                                                                 \
+	} while(0)
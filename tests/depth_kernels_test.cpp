@@ -0,0 +1,138 @@
+#include "book_side.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+// The vector depth kernels against their scalar references, and BookSide's
+// depth_within / estimate_sweep against a brute-force model of the side.
+// Prices span more than the ladder and the window is recentered at random,
+// so levels keep moving between the ring and the overflow map.
+
+namespace {
+
+constexpr Price MID = 100'000;
+constexpr Price TICK = 5;
+constexpr size_t LADDER = 1024;
+
+void test_kernels()
+{
+	using namespace depth_kernels;
+
+	std::mt19937 rng(1);
+	for(int round=0; round<20'000; round++)
+	{
+		const size_t n = rng() % 200;
+		std::vector<Qty> q(n);
+		// mostly empty ticks, and quantities large enough to overflow 32 bits
+		for(Qty& x : q) x = rng() % 3 ? 0 : static_cast<Qty>(rng() % 4'000'000'000u);
+		const uint64_t target = rng() % (uint64_t(1) << 36);
+
+		CHECK(sum(q.data(), n) == scalar::sum(q.data(), n), "sum, n=%zu", n);
+		CHECK(index_weighted_sum(q.data(), n) == scalar::index_weighted_sum(q.data(), n), "index_weighted_sum, n=%zu", n);
+
+		FillPoint a = find_fill(q.data(), n, target);
+		FillPoint b = scalar::find_fill(q.data(), n, target);
+		CHECK(a.index == b.index && a.before == b.before, "find_fill, n=%zu", n);
+
+		a = find_fill_reverse(q.data(), n, target);
+		b = scalar::find_fill_reverse(q.data(), n, target);
+		CHECK(a.index == b.index && a.before == b.before, "find_fill_reverse, n=%zu", n);
+	}
+}
+
+template <Side S>
+void test_side(uint64_t seed)
+{
+	OrderPool pool(1 << 14);
+	auto side = std::make_unique<BookSide<S, LADDER>>(MID, TICK, pool);
+
+	// price -> resting qty, kept best first
+	using Compare = std::conditional_t<S == Side::BID, std::greater<Price>, std::less<Price>>;
+	std::map<Price, uint64_t, Compare> model;
+	std::vector<Order*> live;
+	std::mt19937_64 rng(seed);
+	uint64_t next_id = 1;
+
+	for(int step=0; step<20'000; step++)
+	{
+		const int op = static_cast<int>(rng() % 10);
+		if(op < 5 || live.empty())
+		{
+			Order* order = pool.allocate();
+			order->order_id = next_id++;
+			order->quantity = 1 + static_cast<Qty>(rng() % 100);
+			order->side = S;
+
+			const Price price = MID + TICK * static_cast<Price>(rng() % 1600) - TICK * 800;
+			CHECK(side->add_order(order, price), "add at %u", price);
+			model[price] += order->quantity;
+			live.push_back(order);
+		}
+		else if(op < 8)
+		{
+			const size_t k = rng() % live.size();
+			Order* order = live[k];
+			const Price price = side->price_of(*order);
+			if((model[price] -= order->quantity) == 0) model.erase(price);
+
+			side->remove_order(order);
+			pool.deallocate(order);
+			live[k] = live.back();
+			live.pop_back();
+		}
+		else if(op < 9)
+		{
+			side->recenter(MID + TICK * static_cast<Price>(rng() % 2000) - TICK * 1000);
+		}
+
+		if(step % 7 != 0 || model.empty()) continue;
+
+		const Price best = model.begin()->first;
+		const uint32_t ticks = 1 + static_cast<uint32_t>(rng() % 600);
+		uint64_t expect_depth = 0;
+		for(const auto& [price, qty] : model)
+		{
+			const Price distance = (S == Side::BID ? best - price : price - best) / TICK;
+			if(distance < ticks) expect_depth += qty;
+		}
+		CHECK(side->depth_within(ticks) == expect_depth, "depth_within(%u) at step %d", ticks, step);
+
+		const uint64_t want = rng() % 5000;
+		uint64_t filled = 0;
+		uint64_t notional = 0;
+		Price worst = INVALID_PRICE;
+		for(const auto& [price, qty] : model)
+		{
+			if(filled >= want) break;
+			const uint64_t take = std::min<uint64_t>(qty, want - filled);
+			filled += take;
+			notional += take * price;
+			worst = price;
+		}
+
+		const FillEstimate est = side->estimate_sweep(want);
+		CHECK(est.filled == filled && est.notional == notional && est.worst_price == worst,
+			"estimate_sweep(%lu) at step %d", static_cast<unsigned long>(want), step);
+	}
+}
+
+} // namespace
+
+int main()
+{
+	test_kernels();
+
+	for(uint64_t seed=0; seed<10; seed++)
+	{
+		test_side<Side::BID>(seed);
+		test_side<Side::ASK>(seed);
+	}
+
+	std::printf("depth_kernels_test (%s): ok\n", depth_kernels::ISA);
+	return 0;
+}
@@ -0,0 +1,121 @@
+#include "mpmc.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// mpmc batch edges: zero-length batches on empty, part-full and full queues,
+// runs that wrap the ring or are cut short by it, and several producers and
+// consumers through try_push_n / try_pop_n with per-producer order intact.
+
+namespace {
+
+constexpr size_t QSIZE = 8;
+
+void test_zero_length()
+{
+	mpmc<int> q(QSIZE);
+	int in[QSIZE] = {};
+	int out[QSIZE] = {};
+
+	CHECK(q.try_push_n(in, 0) == 0, "zero push on an empty queue");
+	CHECK(q.try_pop_n(out, 0) == 0, "zero pop on an empty queue");
+
+	CHECK(q.try_push_n(in, 1) == 1, "single push");
+	CHECK(q.try_pop_n(out, 0) == 0, "zero pop with an item queued");
+	CHECK(q.try_push_n(in, 0) == 0, "zero push with an item queued");
+
+	CHECK(q.try_push_n(in, QSIZE) == QSIZE - 1, "fill");
+	CHECK(q.try_push_n(in, 0) == 0, "zero push on a full queue");
+	CHECK(q.try_pop_n(out, 0) == 0, "zero pop on a full queue");
+	CHECK(q.try_pop_n(out, QSIZE) == QSIZE, "drain");
+}
+
+void test_wrap()
+{
+	mpmc<int> q(QSIZE);
+	int next_in = 0;
+	int next_out = 0;
+
+	for(int round=0; round<1000; round++)
+	{
+		int batch[QSIZE + 3];
+		const size_t want = static_cast<size_t>(round % (QSIZE + 3));
+		for(size_t i=0; i<want; i++) batch[i] = next_in + static_cast<int>(i);
+		next_in += static_cast<int>(q.try_push_n(batch, want));
+
+		int out[QSIZE + 3];
+		const size_t got = q.try_pop_n(out, static_cast<size_t>((round * 7) % (QSIZE + 3)));
+		for(size_t i=0; i<got; i++) CHECK(out[i] == next_out++, "order, round %d", round);
+	}
+
+	int out[QSIZE];
+	const size_t got = q.try_pop_n(out, QSIZE);
+	for(size_t i=0; i<got; i++) CHECK(out[i] == next_out++, "order while draining");
+	CHECK(next_out == next_in && q.empty(), "lost items: pushed %d, popped %d", next_in, next_out);
+}
+
+void test_concurrent()
+{
+	constexpr int PRODUCERS = 3;
+	constexpr int CONSUMERS = 2;
+	constexpr int PER_PRODUCER = 200'000;
+	constexpr int SHIFT = 24;
+
+	mpmc<int> q(1 << 10);
+	std::atomic<int> popped{0};
+	std::vector<std::thread> threads;
+
+	for(int p=0; p<PRODUCERS; p++)
+	{
+		threads.emplace_back([&, p]()
+		{
+			int batch[16];
+			for(int s=0; s<PER_PRODUCER;)
+			{
+				const int n = std::min(16, PER_PRODUCER - s);
+				for(int i=0; i<n; i++) batch[i] = (p << SHIFT) | (s + i);
+				s += static_cast<int>(q.try_push_n(batch, static_cast<size_t>(n)));
+				if(s % 64 == 0) std::this_thread::yield();
+			}
+		});
+	}
+	for(int c=0; c<CONSUMERS; c++)
+	{
+		threads.emplace_back([&, c]()
+		{
+			// per-producer order holds within what one consumer sees
+			std::vector<int> last(PRODUCERS, -1);
+			int out[16];
+			while(popped.load() < PRODUCERS * PER_PRODUCER)
+			{
+				const size_t n = q.try_pop_n(out, 1 + static_cast<size_t>(c) * 7);
+				if(n == 0) { std::this_thread::yield(); continue; }
+				for(size_t i=0; i<n; i++)
+				{
+					const int p = out[i] >> SHIFT;
+					const int s = out[i] & ((1 << SHIFT) - 1);
+					CHECK(s > last[p], "producer %d out of order", p);
+					last[p] = s;
+				}
+				popped.fetch_add(static_cast<int>(n));
+			}
+		});
+	}
+	for(auto& t : threads) t.join();
+	CHECK(popped.load() == PRODUCERS * PER_PRODUCER && q.empty(), "count %d", popped.load());
+}
+
+} // namespace
+
+int main()
+{
+	test_zero_length();
+	test_wrap();
+	test_concurrent();
+
+	std::printf("mpmc_test: ok\n");
+	return 0;
+}
@@ -0,0 +1,66 @@
+#include "order_index.hpp"
+#include "check.hpp"
+
+#include <map>
+#include <random>
+#include <vector>
+
+// Both order index policies against a std::map under random inserts,
+// re-inserts and erases. DirectOrderIndex gets ids on both sides of its
+// range so the paged table and the hash fallback are each exercised.
+
+namespace {
+
+constexpr uint64_t BASE = 1'000'000;
+constexpr uint64_t CAPACITY = 1 << 16;
+
+template <typename Index>
+void run(Index& index, uint64_t seed)
+{
+	std::map<uint64_t, Order*> model;
+	std::vector<Order> orders(64);
+	std::mt19937_64 rng(seed);
+
+	for(int step=0; step<200'000; step++)
+	{
+		// mostly in range, some below the base and some past the end
+		const uint64_t r = rng() % 10;
+		const uint64_t id = r == 0 ? rng() % BASE
+			: r == 1 ? BASE + CAPACITY + rng() % 4096
+			: BASE + rng() % 4096;
+
+		if(rng() % 3)
+		{
+			Order* order = &orders[rng() % orders.size()];
+			index.insert(id, order);
+			model[id] = order;
+		}
+		else
+		{
+			index.erase(id);
+			model.erase(id);
+		}
+
+		const auto it = model.find(id);
+		CHECK(index.find(id) == (it == model.end() ? nullptr : it->second), "find(%lu), step %d",
+			static_cast<unsigned long>(id), step);
+		CHECK(index.size() == model.size(), "size %zu vs %zu, step %d", index.size(), model.size(), step);
+	}
+}
+
+} // namespace
+
+int main()
+{
+	for(uint64_t seed=0; seed<4; seed++)
+	{
+		HashOrderIndex hash;
+		run(hash, seed);
+
+		DirectOrderIndex direct(BASE, CAPACITY);
+		run(direct, seed);
+	}
+
+	std::printf("order_index_test: ok\n");
+	return 0;
+}